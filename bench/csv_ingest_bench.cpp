@@ -0,0 +1,174 @@
+// Rows per second reading a generated tickets.csv of 1M rows, or as many as
+// the first argument gives (the loader was measured at 10M). Tickets are
+// spread over 100 trains with 5-stop routes. Two figures are printed:
+//   - splitting and parsing alone, with the CsvReader, CsvFields and
+//     from_chars path the loaders use, and with the stringstream, getline
+//     and std::stoi path they used before
+//   - ReservationSystem::loadTicketsFromCSV as a whole, on one thread and
+//     on one per core, which also books every seat and stores every ticket
+// Writes its files to the working directory and removes them afterwards.
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread bench/csv_ingest_bench.cpp -o csv_ingest_bench
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+
+namespace {
+
+const int TRAINS = 100;
+const int SEATS = 1000;
+const char* const STOPS[] = { "Mumbai Central", "Surat", "Vadodara", "Kota", "New Delhi" };
+const char* const TRAINS_FILE = "csv_ingest_bench_trains.csv";
+const char* const TICKETS_FILE = "csv_ingest_bench_tickets.csv";
+
+// Ticket i goes on train i % TRAINS; each train fills a journey's seats
+// before moving on to the next day, so no seat is booked twice
+void writeFiles(int rows) {
+    std::ofstream trains(TRAINS_FILE);
+    trains << "trainId,trainName,totalSeats,availableSeats,berthsPerCoach,stops,seatMapMode\n";
+    for (int t = 1; t <= TRAINS; t++) {
+        trains << t << ",Train " << t << "," << SEATS << "," << SEATS << ",72,"
+               << STOPS[0] << "|" << STOPS[1] << "|" << STOPS[2] << "|" << STOPS[3] << "|" << STOPS[4]
+               << ",locked\n";
+    }
+
+    std::ofstream tickets(TICKETS_FILE);
+    tickets << "bookingId,trainId,seatNumber,passengerName,boardingStop,alightingStop,journeyDate,"
+            << "waitlistNumber,waitlistPosition,bookingTime\n";
+    int today = todayDate();
+    std::string date;
+    int dateOffset = -1;
+    for (int i = 0; i < rows; i++) {
+        int journey = i / TRAINS;
+        if (journey / SEATS != dateOffset) {
+            dateOffset = journey / SEATS;
+            date = formatDate(addDays(today, dateOffset));
+        }
+        tickets << BookingIdGenerator::next("BK") << "," << i % TRAINS + 1 << "," << journey % SEATS + 1
+                << ",Passenger " << i << "," << STOPS[0] << "," << STOPS[4] << "," << date
+                << ",0,0,Mon Jan  1 09:00:00 2024\n";
+    }
+}
+
+// The fields a loader checks: train, seat, journey date and the two waitlist numbers
+struct ParsedRow {
+    int trainId;
+    int seatNumber;
+    int journeyDate;
+    int waitlistNumber;
+    int waitlistPosition;
+};
+
+// Splits and parses every row the way the loaders do now; returns the row count
+size_t parseWithStringViews(long long& checksum) {
+    CsvReader reader(TICKETS_FILE);
+    std::string_view line;
+    reader.nextLine(line);
+    size_t rows = 0;
+    while (reader.nextLine(line)) {
+        CsvFields fields(line);
+        std::string_view field;
+        ParsedRow row = ParsedRow();
+        fields.next(field);
+        fields.next(field);
+        parseIntField(field, row.trainId);
+        fields.next(field);
+        parseIntField(field, row.seatNumber);
+        fields.next(field);
+        fields.next(field);
+        fields.next(field);
+        fields.next(field);
+        parseDateField(field, row.journeyDate);
+        fields.next(field);
+        parseIntField(field, row.waitlistNumber);
+        fields.next(field);
+        parseIntField(field, row.waitlistPosition);
+        checksum += row.trainId + row.seatNumber + row.journeyDate + row.waitlistNumber + row.waitlistPosition;
+        rows++;
+    }
+    return rows;
+}
+
+// The same with the loaders' former stringstream split, field copies and std::stoi
+size_t parseWithStringStreams(long long& checksum) {
+    std::ifstream file(TICKETS_FILE);
+    std::string line;
+    std::getline(file, line);
+    size_t rows = 0;
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::string bookingId, trainId, seatNumber, passengerName, boardingStop, alightingStop;
+        std::string journeyDate, waitlistNumber, waitlistPosition, bookingTime;
+        std::getline(ss, bookingId, ',');
+        std::getline(ss, trainId, ',');
+        std::getline(ss, seatNumber, ',');
+        std::getline(ss, passengerName, ',');
+        std::getline(ss, boardingStop, ',');
+        std::getline(ss, alightingStop, ',');
+        std::getline(ss, journeyDate, ',');
+        std::getline(ss, waitlistNumber, ',');
+        std::getline(ss, waitlistPosition, ',');
+        std::getline(ss, bookingTime);
+        ParsedRow row = ParsedRow();
+        row.trainId = std::stoi(trainId);
+        row.seatNumber = std::stoi(seatNumber);
+        row.journeyDate = std::stoi(journeyDate.substr(0, 4)) * 10000 + std::stoi(journeyDate.substr(5, 2)) * 100 +
+                          std::stoi(journeyDate.substr(8, 2));
+        row.waitlistNumber = std::stoi(waitlistNumber);
+        row.waitlistPosition = std::stoi(waitlistPosition);
+        checksum += row.trainId + row.seatNumber + row.journeyDate + row.waitlistNumber + row.waitlistPosition;
+        rows++;
+    }
+    return rows;
+}
+
+template <typename Parse>
+double parseRate(Parse parse, long long& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    size_t rows = parse(checksum);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return rows / seconds;
+}
+
+double loadRate(int rows, size_t threads) {
+    ReservationSystem system;
+    system.loadTrainsFromCSV(TRAINS_FILE);
+    auto start = std::chrono::steady_clock::now();
+    system.loadTicketsFromCSV(TICKETS_FILE, threads);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return rows / seconds;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    // The loaders report on the console; only the figures matter here
+    std::cout.setstate(std::ios::failbit);
+
+    int rows = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    if (rows <= 0 || rows > TRAINS * SEATS * 365) {
+        std::printf("Row count must be between 1 and %d\n", TRAINS * SEATS * 365);
+        return 1;
+    }
+    writeFiles(rows);
+
+    long long viewChecksum = 0;
+    long long streamChecksum = 0;
+    double views = parseRate(parseWithStringViews, viewChecksum);
+    double streams = parseRate(parseWithStringStreams, streamChecksum);
+    if (viewChecksum != streamChecksum) {
+        std::printf("The two parsers disagree\n");
+    }
+    std::printf("%d rows\n", rows);
+    std::printf("%-34s %12.0f rows/s\n", "split and parse, string_view", views);
+    std::printf("%-34s %12.0f rows/s\n", "split and parse, stringstream", streams);
+    std::printf("%-34s %12.0f rows/s\n", "loadTicketsFromCSV, 1 thread", loadRate(rows, 1));
+    std::printf("%-34s %12.0f rows/s\n", "loadTicketsFromCSV, all threads", loadRate(rows, 0));
+    std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+
+    std::remove(TRAINS_FILE);
+    std::remove(TICKETS_FILE);
+    return 0;
+}
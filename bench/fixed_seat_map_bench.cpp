@@ -0,0 +1,59 @@
+// Compares trains of fleet capacities (72, 100, 864 and 1200 seats), whose
+// seat maps are inline FixedSeatBitmaps, with trains one seat larger, which
+// fall back to the heap-allocated seat words. Each operation books a segment
+// seat on a five-stop train that is nearly full and cancels it again.
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread bench/fixed_seat_map_bench.cpp -o fixed_seat_map_bench
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+
+// Segment book-and-cancel operations per second on a train of the given size
+double segmentBookingRate(int seats, int operations) {
+    std::vector<std::string> route = { "A", "B", "C", "D", "E" };
+    Train train(1, "Bench", seats, SeatLayout::DEFAULT_BERTHS_PER_COACH, route);
+    // Leave a few seats free near the end so searches cross most of the map
+    for (int seat = 1; seat <= seats - 4; seat++) {
+        train.bookSpecificSeat(seat);
+    }
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> stop(0, 3);
+    long checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < operations; i++) {
+        int from = stop(random);
+        int to = from + 1 + static_cast<int>(random() % (4 - from));
+        int seat = train.bookSegmentSeat(from, to);
+        train.cancelSeat(seat, from, to);
+        checksum += seat;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (checksum < 0) {
+        std::printf("impossible\n"); // keeps the loop from being optimised away
+    }
+    return operations / seconds;
+}
+
+// Best of several runs, since a run can lose the core part of the way through
+double bestSegmentBookingRate(int seats, int operations) {
+    double best = 0;
+    for (int run = 0; run < 5; run++) {
+        best = std::max(best, segmentBookingRate(seats, operations));
+    }
+    return best;
+}
+
+int main() {
+    const int fleetSizes[] = { 72, 100, 864, 1200 };
+    const int operations = 1000000;
+    std::printf("%6s %16s %6s %16s %9s\n", "seats", "inline ops/s", "seats", "heap ops/s", "speedup");
+    for (int seats : fleetSizes) {
+        double fixed = bestSegmentBookingRate(seats, operations);
+        double dynamic = bestSegmentBookingRate(seats + 1, operations);
+        std::printf("%6d %16.0f %6d %16.0f %8.2fx\n", seats, fixed, seats + 1, dynamic, fixed / dynamic);
+    }
+    return 0;
+}
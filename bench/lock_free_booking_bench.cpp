@@ -0,0 +1,70 @@
+// Bookings per second on one train from 1 to 64 threads, for a train whose
+// seat map is claimed with atomic compare-and-swap (lockfree) and for the
+// same train booked under its mutex (locked). Every thread books whole-route
+// seats through ReservationSystem::bookSeat until its share of the total is
+// done, so each figure includes ticket creation and the bookings table.
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread bench/lock_free_booking_bench.cpp -o lock_free_booking_bench
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+
+namespace {
+
+const int SEATS = 1000000;
+const int BOOKINGS = 200000;
+const char* const TRAINS_FILE = "lock_free_booking_bench_trains.csv";
+
+double bookingRate(const std::string& seatMapMode, int threadCount) {
+    {
+        std::ofstream file(TRAINS_FILE);
+        file << "trainId,trainName,totalSeats,availableSeats,berthsPerCoach,stops,seatMapMode\n";
+        file << "1,Bench," << SEATS << "," << SEATS << ",72,Origin|Destination," << seatMapMode << "\n";
+    }
+    ReservationSystem system;
+    system.loadTrainsFromCSV(TRAINS_FILE);
+    std::remove(TRAINS_FILE);
+    int date = todayDate();
+
+    std::atomic<int> failed(0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&system, &failed, date, threadCount, t]() {
+            int share = BOOKINGS / threadCount + (t < BOOKINGS % threadCount ? 1 : 0);
+            for (int i = 0; i < share; i++) {
+                BookingResult result = system.bookSeat(1, date, "Passenger", BerthPreference::None);
+                if (!result.success || result.seatNumber == 0) {
+                    failed++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (failed > 0) {
+        std::printf("%d bookings failed\n", failed.load());
+    }
+    return BOOKINGS / seconds;
+}
+
+}
+
+int main() {
+    // The loaders report on the console; only the figures matter here
+    std::cout.setstate(std::ios::failbit);
+
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    std::printf("%8s %18s %18s %9s\n", "threads", "locked bookings/s", "lockfree bookings/s", "speedup");
+    for (int threads : threadCounts) {
+        double locked = bookingRate("locked", threads);
+        double lockFree = bookingRate("lockfree", threads);
+        std::printf("%8d %18.0f %18.0f %8.2fx\n", threads, locked, lockFree, lockFree / locked);
+    }
+    std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Operations per second on one busy train from 1 to 64 threads, with 95%
+// reads and 5% writes against the same train, and with reads alone. Reads
+// alternate between ReservationSystem::findTicketStatus for a random ticket,
+// most of them waitlisted, and getAvailableSeats. Writes book a ticket and
+// cancel it again. A write costs far more than a read, so the mix is slower
+// on one thread; since reads take no lock, its rate should then hold as
+// threads are added instead of falling as readers queue behind writers.
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread bench/optimistic_read_bench.cpp -o optimistic_read_bench
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+#include <random>
+
+namespace {
+
+const int SEATS = 1000;
+const int TICKETS = 10000; // the ones past SEATS are waitlisted
+const int OPERATIONS = 2000000;
+const char* const TRAINS_FILE = "optimistic_read_bench_trains.csv";
+
+double operationRate(ReservationSystem& system, int date, const std::vector<std::string>& bookingIds,
+                     int threadCount, int writePercent) {
+    std::atomic<int> missing(0);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 random(t + 1);
+            int share = OPERATIONS / threadCount + (t < OPERATIONS % threadCount ? 1 : 0);
+            for (int i = 0; i < share; i++) {
+                int roll = static_cast<int>(random() % 100);
+                if (roll < writePercent) {
+                    BookingResult booked = system.bookSeat(1, date, "Writer", BerthPreference::None);
+                    if (booked.success) {
+                        system.cancelBooking(booked.bookingId);
+                    }
+                } else if (roll % 2 == 0) {
+                    StatusResult status = system.findTicketStatus(bookingIds[random() % bookingIds.size()]);
+                    if (!status.found) {
+                        missing++;
+                    }
+                } else {
+                    system.getAvailableSeats(1, date);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (missing > 0) {
+        std::printf("%d tickets not found\n", missing.load());
+    }
+    return OPERATIONS / seconds;
+}
+
+}
+
+int main() {
+    // The system reports every cancellation on the console; only the figures matter here
+    std::cout.setstate(std::ios::failbit);
+
+    {
+        std::ofstream file(TRAINS_FILE);
+        file << "trainId,trainName,totalSeats,availableSeats,berthsPerCoach,stops,seatMapMode\n";
+        file << "1,Bench," << SEATS << "," << SEATS << ",72,Origin|Destination,locked\n";
+    }
+    ReservationSystem system;
+    system.loadTrainsFromCSV(TRAINS_FILE);
+    std::remove(TRAINS_FILE);
+    int date = todayDate();
+
+    std::vector<std::string> bookingIds;
+    for (int i = 0; i < TICKETS; i++) {
+        bookingIds.push_back(system.bookSeat(1, date, "Reader", BerthPreference::None).bookingId);
+    }
+
+    const int threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+    std::printf("%8s %16s %16s %8s\n", "threads", "read-only ops/s", "95/5 ops/s", "ratio");
+    for (int threads : threadCounts) {
+        double readOnly = operationRate(system, date, bookingIds, threads, 0);
+        double mixed = operationRate(system, date, bookingIds, threads, 5);
+        std::printf("%8d %16.0f %16.0f %7.2fx\n", threads, readOnly, mixed, mixed / readOnly);
+    }
+    std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+    return 0;
+}
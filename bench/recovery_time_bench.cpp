@@ -0,0 +1,109 @@
+// Startup time after a crash, for booking histories of 50k to 800k tickets,
+// with no checkpoints and with a checkpoint every 50k bookings, the last one
+// 25k bookings before the crash. Eight threads book whole-route seats on one
+// train and cancel nine tickets in ten, so the log holds far more changes
+// than live tickets. The system is then dropped without a final checkpoint,
+// and the figure is the time to load the last snapshot, if any, and replay
+// the write-ahead log on top of it. Without checkpoints it grows with the
+// history; with them it stays bounded by one interval of changes. Writes its
+// files to the working directory and removes them afterwards.
+//
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread bench/recovery_time_bench.cpp -o recovery_time_bench
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+
+namespace {
+
+const int SEATS = 100000;
+const int THREADS = 8;
+const int CHECKPOINT_EVERY = 50000;
+const char* const TRAINS_FILE = "recovery_time_bench_trains.csv";
+const char* const LOG_FILE = "recovery_time_bench.wal";
+const char* const SNAPSHOT_FILE = "recovery_time_bench.snap";
+
+void removeFiles() {
+    for (int segment = 1; segment < 1000; segment++) {
+        std::remove((std::string(LOG_FILE) + "." + std::to_string(segment)).c_str());
+    }
+    std::remove((std::string(LOG_FILE) + ".checkpoint").c_str());
+    std::remove(SNAPSHOT_FILE);
+}
+
+void loadTrain(ReservationSystem& system) {
+    {
+        std::ofstream file(TRAINS_FILE);
+        file << "trainId,trainName,totalSeats,availableSeats,berthsPerCoach,stops,seatMapMode\n";
+        file << "1,Bench," << SEATS << "," << SEATS << ",72,Origin|Destination,lockfree\n";
+    }
+    system.loadTrainsFromCSV(TRAINS_FILE);
+    std::remove(TRAINS_FILE);
+}
+
+// Builds the history; the system's destructor closes the log like a crash
+// after the last sync, with no final checkpoint
+void writeHistory(int bookings, bool checkpoints) {
+    ReservationSystem system;
+    loadTrain(system);
+    system.openWriteAheadLog(LOG_FILE, std::chrono::microseconds(0));
+    int date = todayDate();
+
+    std::atomic<int> booked(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&]() {
+            for (;;) {
+                int number = ++booked;
+                if (number > bookings) {
+                    return;
+                }
+                BookingResult result = system.bookSeat(1, date, "Passenger", BerthPreference::None);
+                if (result.success && number % 10 != 0) {
+                    system.cancelBooking(result.bookingId);
+                }
+                if (checkpoints && number % CHECKPOINT_EVERY == CHECKPOINT_EVERY / 2) {
+                    system.checkpoint(SNAPSHOT_FILE);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Seconds to rebuild the system from the files writeHistory left
+double recoverySeconds(bool checkpoints) {
+    auto start = std::chrono::steady_clock::now();
+    ReservationSystem system;
+    if (checkpoints) {
+        system.loadSnapshot(SNAPSHOT_FILE);
+    } else {
+        loadTrain(system);
+    }
+    system.openWriteAheadLog(LOG_FILE);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main() {
+    // The loaders and the log report on the console; only the figures matter here
+    std::cout.setstate(std::ios::failbit);
+
+    const int histories[] = { 50000, 200000, 800000 };
+    std::printf("%10s %16s %18s\n", "bookings", "no checkpoints", "every 50k");
+    for (int bookings : histories) {
+        removeFiles();
+        writeHistory(bookings, false);
+        double full = recoverySeconds(false);
+        removeFiles();
+        writeHistory(bookings, true);
+        double bounded = recoverySeconds(true);
+        removeFiles();
+        std::printf("%10d %15.3fs %17.3fs\n", bookings, full, bounded);
+    }
+    return 0;
+}
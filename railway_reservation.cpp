@@ -1,767 +1,6823 @@
-#include <iostream>
-#include <string>
-#include <vector>
-#include <unordered_map>
-#include <ctime>
-#include <iomanip>
-#include <sstream>
-#include <algorithm>
-#include <limits>
-#include <random>
-#include <stdexcept>
-#include <fstream>
-
-// Custom exceptions
-class TrainNotFoundException : public std::runtime_error {
-public:
-    TrainNotFoundException(int id) : 
-        std::runtime_error("Train with ID " + std::to_string(id) + " not found!") {}
-};
-
-class SeatNotFoundException : public std::runtime_error {
-public:
-    SeatNotFoundException(int trainId, int seatNo) : 
-        std::runtime_error("Seat number " + std::to_string(seatNo) + 
-                         " on train " + std::to_string(trainId) + " is invalid!") {}
-};
-
-class NoSeatsAvailableException : public std::runtime_error {
-public:
-    NoSeatsAvailableException(int trainId) : 
-        std::runtime_error("No seats available on train " + std::to_string(trainId) + "!") {}
-};
-
-class TicketNotFoundException : public std::runtime_error {
-public:
-    TicketNotFoundException(const std::string& bookingId) : 
-        std::runtime_error("Ticket with booking ID " + bookingId + " not found!") {}
-};
-
-class FileIOException : public std::runtime_error {
-public:
-    FileIOException(const std::string& filename, const std::string& operation) : 
-        std::runtime_error("Failed to " + operation + " file: " + filename) {}
-};
-
-class InvalidInputException : public std::runtime_error {
-public:
-    InvalidInputException(const std::string& message) : 
-        std::runtime_error("Invalid input: " + message) {}
-};
-
-class Train {
-private:
-    int trainId;
-    std::string trainName;
-    int totalSeats;
-    std::vector<bool> seatAvailability; // true means seat is available
-
-public:
-    Train(int id, std::string name, int seats) : 
-        trainId(id), trainName(name), totalSeats(seats) {
-        // Validate input parameters
-        if (id <= 0) throw InvalidInputException("Train ID must be positive");
-        if (name.empty()) throw InvalidInputException("Train name cannot be empty");
-        if (seats <= 0) throw InvalidInputException("Number of seats must be positive");
-        
-        seatAvailability.resize(totalSeats, true);
-    }
-
-    int getTrainId() const { return trainId; }
-    std::string getTrainName() const { return trainName; }
-    int getTotalSeats() const { return totalSeats; }
-    
-    bool isSeatAvailable(int seatNumber) const {
-        if (seatNumber < 1 || seatNumber > totalSeats) {
-            throw SeatNotFoundException(trainId, seatNumber);
-        }
-        return seatAvailability[seatNumber - 1];
-    }
-    
-    int getAvailableSeatsCount() const {
-        return std::count(seatAvailability.begin(), seatAvailability.end(), true);
-    }
-    
-    int bookNextAvailableSeat() {
-        for (int i = 0; i < totalSeats; i++) {
-            if (seatAvailability[i]) {
-                seatAvailability[i] = false;
-                return i + 1; // Seat number (1-based)
-            }
-        }
-        throw NoSeatsAvailableException(trainId);
-    }
-    
-    bool bookSpecificSeat(int seatNumber) {
-        if (seatNumber < 1 || seatNumber > totalSeats) {
-            throw SeatNotFoundException(trainId, seatNumber);
-        }
-        
-        if (seatAvailability[seatNumber - 1]) {
-            seatAvailability[seatNumber - 1] = false;
-            return true;
-        }
-        
-        return false; // Seat already booked
-    }
-    
-    bool cancelSeat(int seatNumber) {
-        if (seatNumber < 1 || seatNumber > totalSeats) {
-            throw SeatNotFoundException(trainId, seatNumber);
-        }
-        
-        if (!seatAvailability[seatNumber - 1]) {
-            seatAvailability[seatNumber - 1] = true;
-            return true;
-        }
-        
-        return false; // Seat was already available (not booked)
-    }
-};
-
-class Ticket {
-private:
-    std::string bookingId;
-    int trainId;
-    int seatNumber;
-    std::string passengerName;
-    std::string bookingTime;
-    
-public:
-    Ticket(std::string id, int train, int seat, std::string passenger) :
-        bookingId(id), trainId(train), seatNumber(seat), passengerName(passenger) {
-        
-        // Validate input parameters
-        if (id.empty()) throw InvalidInputException("Booking ID cannot be empty");
-        if (train <= 0) throw InvalidInputException("Train ID must be positive");
-        if (seat <= 0) throw InvalidInputException("Seat number must be positive");
-        if (passenger.empty()) throw InvalidInputException("Passenger name cannot be empty");
-        
-        // Generate current timestamp for booking
-        time_t now = time(0);
-        tm* ltm = localtime(&now);
-        std::stringstream ss;
-        ss << std::setfill('0') 
-           << std::setw(2) << 1 + ltm->tm_mon << "/"
-           << std::setw(2) << ltm->tm_mday << "/"
-           << 1900 + ltm->tm_year << " "
-           << std::setw(2) << ltm->tm_hour << ":"
-           << std::setw(2) << ltm->tm_min << ":"
-           << std::setw(2) << ltm->tm_sec;
-        bookingTime = ss.str();
-    }
-    
-    std::string getBookingId() const { return bookingId; }
-    int getTrainId() const { return trainId; }
-    int getSeatNumber() const { return seatNumber; }
-    std::string getPassengerName() const { return passengerName; }
-    std::string getBookingTime() const { return bookingTime; }
-    
-    void displayTicket() const {
-        std::cout << "\n========== TICKET DETAILS ==========\n";
-        std::cout << "Booking ID: " << bookingId << std::endl;
-        std::cout << "Train ID: " << trainId << std::endl;
-        std::cout << "Seat Number: " << seatNumber << std::endl;
-        std::cout << "Passenger Name: " << passengerName << std::endl;
-        std::cout << "Booking Time: " << bookingTime << std::endl;
-        std::cout << "===================================\n";
-    }
-};
-
-class ReservationSystem {
-private:
-    std::vector<Train> trains;
-    std::unordered_map<std::string, Ticket> bookings;
-    std::random_device rd;
-    std::mt19937 gen;
-    
-    std::string generateBookingId() {
-        const std::string chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-        std::uniform_int_distribution<> dis(0, chars.size() - 1);
-        
-        std::string id = "BK";
-        for (int i = 0; i < 8; i++) {
-            id += chars[dis(gen)];
-        }
-        
-        // Check if this ID already exists (unlikely but possible)
-        if (bookings.find(id) != bookings.end()) {
-            return generateBookingId(); // try again
-        }
-        
-        return id;
-    }
-    
-public:
-    ReservationSystem() : gen(rd()) {
-        try {
-            // Initialize with some trains
-            trains.push_back(Train(1001, "Express Delhi", 100));
-            trains.push_back(Train(1002, "Mumbai Local", 100));
-            trains.push_back(Train(1003, "Chennai Mail", 100));
-            trains.push_back(Train(1004, "Kolkata Express", 100));
-        } catch (const InvalidInputException& e) {
-            std::cerr << "Error during initialization: " << e.what() << std::endl;
-            // In a real application, you might want to log this and take appropriate action
-        }
-    }
-    
-    void displayAllTrains() {
-        if (trains.empty()) {
-            std::cout << "No trains available in the system.\n";
-            return;
-        }
-        
-        std::cout << "\n========== AVAILABLE TRAINS ==========\n";
-        std::cout << std::left << std::setw(10) << "Train ID"
-                 << std::setw(20) << "Train Name"
-                 << std::setw(15) << "Total Seats"
-                 << std::setw(15) << "Available Seats" << std::endl;
-        std::cout << std::string(60, '-') << std::endl;
-        
-        for (const auto& train : trains) {
-            std::cout << std::left << std::setw(10) << train.getTrainId()
-                     << std::setw(20) << train.getTrainName()
-                     << std::setw(15) << train.getTotalSeats()
-                     << std::setw(15) << train.getAvailableSeatsCount() << std::endl;
-        }
-        std::cout << "=====================================\n";
-    }
-    
-    void checkSeatAvailability(int trainId) {
-        try {
-            const Train& train = findTrain(trainId);
-            int availableSeats = train.getAvailableSeatsCount();
-            std::cout << "Train " << trainId << " (" << train.getTrainName() << ") has " 
-                      << availableSeats << " seat(s) available out of " 
-                      << train.getTotalSeats() << std::endl;
-            
-            if (availableSeats == 0) {
-                std::cout << "Sorry, the train is fully booked.\n";
-            }
-        } catch (const TrainNotFoundException& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-        }
-    }
-    
-    std::string bookTicket(int trainId, const std::string& passengerName) {
-        if (passengerName.empty()) {
-            std::cerr << "Error: Passenger name cannot be empty.\n";
-            return "";
-        }
-        
-        try {
-            Train& train = findTrainRef(trainId);
-            
-            try {
-                int seatNumber = train.bookNextAvailableSeat();
-                std::string bookingId = generateBookingId();
-                
-                try {
-                    bookings.emplace(bookingId, Ticket(bookingId, trainId, seatNumber, passengerName));
-                    
-                    std::cout << "Ticket booked successfully!\n";
-                    bookings.at(bookingId).displayTicket();
-                    
-                    return bookingId;
-                } catch (const InvalidInputException& e) {
-                    // Undo seat booking if ticket creation fails
-                    train.cancelSeat(seatNumber);
-                    std::cerr << "Error creating ticket: " << e.what() << std::endl;
-                    return "";
-                }
-            } catch (const NoSeatsAvailableException& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                return "";
-            }
-        } catch (const TrainNotFoundException& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-            return "";
-        }
-    }
-    
-    bool cancelTicket(const std::string& bookingId) {
-        try {
-            const Ticket& ticket = findTicket(bookingId);
-            int trainId = ticket.getTrainId();
-            int seatNumber = ticket.getSeatNumber();
-            
-            try {
-                Train& train = findTrainRef(trainId);
-                
-                try {
-                    if (train.cancelSeat(seatNumber)) {
-                        std::cout << "Ticket with Booking ID " << bookingId << " cancelled successfully!\n";
-                        bookings.erase(bookingId);
-                        return true;
-                    } else {
-                        std::cerr << "Failed to cancel seat. This is unexpected.\n";
-                        return false;
-                    }
-                } catch (const SeatNotFoundException& e) {
-                    std::cerr << "Error: " << e.what() << std::endl;
-                    return false;
-                }
-            } catch (const TrainNotFoundException& e) {
-                std::cerr << "Error: " << e.what() << std::endl;
-                return false;
-            }
-        } catch (const TicketNotFoundException& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-            return false;
-        }
-    }
-    
-    bool checkTicketStatus(const std::string& bookingId) {
-        try {
-            const Ticket& ticket = findTicket(bookingId);
-            std::cout << "Ticket found! Here are the details:\n";
-            ticket.displayTicket();
-            return true;
-        } catch (const TicketNotFoundException& e) {
-            std::cerr << "Error: " << e.what() << std::endl;
-            return false;
-        }
-    }
-    
-    void loadTrainsFromCSV(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            throw FileIOException(filename, "open");
-        }
-        
-        // Clear existing trains
-        trains.clear();
-        
-        std::string line;
-        // Skip header line
-        std::getline(file, line);
-        
-        while (std::getline(file, line)) {
-            std::stringstream ss(line);
-            std::string token;
-            
-            try {
-                int trainId;
-                std::string trainName;
-                int totalSeats;
-                int availableSeats;
-                
-                // Parse trainId
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing train ID");
-                try {
-                    trainId = std::stoi(token);
-                } catch (const std::exception&) {
-                    throw InvalidInputException("train ID is not a valid number: " + token);
-                }
-                
-                // Parse trainName
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing train name");
-                trainName = token;
-                
-                // Parse totalSeats
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing total seats");
-                try {
-                    totalSeats = std::stoi(token);
-                } catch (const std::exception&) {
-                    throw InvalidInputException("total seats is not a valid number: " + token);
-                }
-                
-                // Parse availableSeats
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing available seats");
-                try {
-                    availableSeats = std::stoi(token);
-                } catch (const std::exception&) {
-                    throw InvalidInputException("available seats is not a valid number: " + token);
-                }
-                
-                // Create and add the train
-                Train train(trainId, trainName, totalSeats);
-                
-                // If some seats are already booked, mark them as unavailable
-                int bookedSeats = totalSeats - availableSeats;
-                for (int i = 0; i < bookedSeats && i < totalSeats; i++) {
-                    try {
-                        train.bookNextAvailableSeat();
-                    } catch (const NoSeatsAvailableException&) {
-                        std::cerr << "Warning: CSV file has inconsistent seat data for train " << trainId << std::endl;
-                        break;
-                    }
-                }
-                
-                trains.push_back(train);
-                
-            } catch (const InvalidInputException& e) {
-                std::cerr << "Error parsing CSV line: " << e.what() << std::endl;
-                std::cerr << "Line content: " << line << std::endl;
-                // Continue to next line
-            }
-        }
-        
-        std::cout << "Loaded " << trains.size() << " trains from " << filename << std::endl;
-    }
-    
-    void saveTrainsToCSV(const std::string& filename) {
-        std::ofstream file(filename);
-        if (!file.is_open()) {
-            throw FileIOException(filename, "open for writing");
-        }
-        
-        // Write header
-        file << "trainId,trainName,totalSeats,availableSeats\n";
-        
-        // Write train data
-        for (const auto& train : trains) {
-            file << train.getTrainId() << ","
-                 << train.getTrainName() << ","
-                 << train.getTotalSeats() << ","
-                 << train.getAvailableSeatsCount() << "\n";
-        }
-        
-        if (file.fail()) {
-            throw FileIOException(filename, "write to");
-        }
-        
-        std::cout << "Saved " << trains.size() << " trains to " << filename << std::endl;
-    }
-    
-    void loadTicketsFromCSV(const std::string& filename) {
-        std::ifstream file(filename);
-        if (!file.is_open()) {
-            throw FileIOException(filename, "open");
-        }
-        
-        // Clear existing bookings
-        bookings.clear();
-        
-        std::string line;
-        // Skip header line
-        std::getline(file, line);
-        
-        int loadedTickets = 0;
-        int errorCount = 0;
-        
-        while (std::getline(file, line)) {
-            std::stringstream ss(line);
-            std::string token;
-            
-            try {
-                std::string bookingId;
-                int trainId;
-                int seatNumber;
-                std::string passengerName;
-                std::string bookingTime;
-                
-                // Parse bookingId
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing booking ID");
-                bookingId = token;
-                
-                // Parse trainId
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing train ID");
-                try {
-                    trainId = std::stoi(token);
-                } catch (const std::exception&) {
-                    throw InvalidInputException("train ID is not a valid number: " + token);
-                }
-                
-                // Parse seatNumber
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing seat number");
-                try {
-                    seatNumber = std::stoi(token);
-                } catch (const std::exception&) {
-                    throw InvalidInputException("seat number is not a valid number: " + token);
-                }
-                
-                // Parse passengerName
-                if (!std::getline(ss, token, ',')) throw InvalidInputException("missing passenger name");
-                passengerName = token;
-                
-                // Parse bookingTime (rest of the line)
-                std::getline(ss, bookingTime);
-                
-                // Find the corresponding train
-                try {
-                    Train& train = findTrainRef(trainId);
-                    
-                    // Try to book the specific seat
-                    try {
-                        if (train.bookSpecificSeat(seatNumber)) {
-                            // Create a ticket with the loaded data
-                            try {
-                                bookings.emplace(bookingId, Ticket(bookingId, trainId, seatNumber, passengerName));
-                                loadedTickets++;
-                            } catch (const InvalidInputException& e) {
-                                std::cerr << "Error creating ticket from CSV: " << e.what() << std::endl;
-                                std::cerr << "Line content: " << line << std::endl;
-                                // Undo the seat booking
-                                train.cancelSeat(seatNumber);
-                                errorCount++;
-                            }
-                        } else {
-                            std::cerr << "Warning: Seat " << seatNumber << " on train " << trainId 
-                                      << " is already booked. Skipping ticket: " << bookingId << std::endl;
-                            errorCount++;
-                        }
-                    } catch (const SeatNotFoundException& e) {
-                        std::cerr << "Error booking seat from CSV: " << e.what() << std::endl;
-                        std::cerr << "Line content: " << line << std::endl;
-                        errorCount++;
-                    }
-                } catch (const TrainNotFoundException& e) {
-                    std::cerr << "Error finding train from CSV: " << e.what() << std::endl;
-                    std::cerr << "Line content: " << line << std::endl;
-                    errorCount++;
-                }
-                
-            } catch (const InvalidInputException& e) {
-                std::cerr << "Error parsing CSV line: " << e.what() << std::endl;
-                std::cerr << "Line content: " << line << std::endl;
-                errorCount++;
-                // Continue to next line
-            }
-        }
-        
-        std::cout << "Loaded " << loadedTickets << " tickets from " << filename << std::endl;
-        if (errorCount > 0) {
-            std::cout << "Warning: " << errorCount << " tickets could not be loaded due to errors." << std::endl;
-        }
-    }
-    
-    void saveTicketsToCSV(const std::string& filename) {
-        std::ofstream file(filename);
-        if (!file.is_open()) {
-            throw FileIOException(filename, "open for writing");
-        }
-        
-        // Write header
-        file << "bookingId,trainId,seatNumber,passengerName,bookingTime\n";
-        
-        // Write ticket data
-        for (const auto& pair : bookings) {
-            const std::string& id = pair.first;
-            const Ticket& ticket = pair.second;        
-            file << ticket.getBookingId() << ","
-                 << ticket.getTrainId() << ","
-                 << ticket.getSeatNumber() << ","
-                 << ticket.getPassengerName() << ","
-                 << ticket.getBookingTime() << "\n";
-        }
-        
-        if (file.fail()) {
-            throw FileIOException(filename, "write to");
-        }
-        
-        std::cout << "Saved " << bookings.size() << " tickets to " << filename << std::endl;
-    }
-    
-private:
-    // Helper method to find a train by ID (const version)
-    const Train& findTrain(int trainId) const {
-        for (const auto& train : trains) {
-            if (train.getTrainId() == trainId) {
-                return train;
-            }
-        }
-        throw TrainNotFoundException(trainId);
-    }
-    
-    // Helper method to find a train by ID (non-const version for modifications)
-    Train& findTrainRef(int trainId) {
-        for (auto& train : trains) {
-            if (train.getTrainId() == trainId) {
-                return train;
-            }
-        }
-        throw TrainNotFoundException(trainId);
-    }
-    
-    // Helper method to find a ticket by booking ID
-    const Ticket& findTicket(const std::string& bookingId) const {
-        auto it = bookings.find(bookingId);
-        if (it == bookings.end()) {
-            throw TicketNotFoundException(bookingId);
-        }
-        return it->second;
-    }
-};
-
-// Function to safely get integer input from user
-int getIntInput() {
-    int value;
-    std::string input;
-    
-    std::getline(std::cin, input);
-    
-    try {
-        // Handle empty input
-        if (input.empty()) {
-            throw InvalidInputException("input is empty");
-        }
-        
-        // Check if input contains only digits
-        for (char c : input) {
-            if (!std::isdigit(c)) {
-                throw InvalidInputException("input contains non-numeric characters");
-            }
-        }
-        
-        value = std::stoi(input);
-        
-        // Check if value is in reasonable range
-        if (value < 0 || value > 10000) {
-            throw InvalidInputException("input is out of reasonable range (0-10000)");
-        }
-        
-        return value;
-        
-    } catch (const InvalidInputException& e) {
-        std::cerr << "Invalid input: " << e.what() << std::endl;
-        std::cerr << "Please enter a valid number." << std::endl;
-        return -1; // Indicate error
-    } catch (const std::out_of_range&) {
-        std::cerr << "Invalid input: number is too large" << std::endl;
-        return -1; // Indicate error
-    } catch (const std::exception& e) {
-        std::cerr << "Unexpected error: " << e.what() << std::endl;
-        return -1; // Indicate error
-    }
-}
-
-void displayMainMenu() {
-    std::cout << "\n====== RAILWAY RESERVATION SYSTEM ======\n";
-    std::cout << "1. Display All Trains\n";
-    std::cout << "2. Check Seat Availability\n";
-    std::cout << "3. Book a Ticket\n";
-    std::cout << "4. Cancel a Ticket\n";
-    std::cout << "5. Check Ticket Status\n";
-    std::cout << "0. Exit\n";
-    std::cout << "========================================\n";
-    std::cout << "Enter your choice: ";
-}
-
-int main() {
-    ReservationSystem reservationSystem;
-    int choice;
-    
-    std::cout << "Welcome to Railway Reservation System!\n";
-    
-    try {
-        // Try to load data from CSV files
-        try {
-            reservationSystem.loadTrainsFromCSV("trains.csv");
-        } catch (const FileIOException& e) {
-            std::cout << "Note: " << e.what() << ". Using default trains." << std::endl;
-        }
-        
-        try {
-            reservationSystem.loadTicketsFromCSV("tickets.csv");
-        } catch (const FileIOException& e) {
-            std::cout << "Note: " << e.what() << ". Starting with no existing bookings." << std::endl;
-        }
-        
-        do {
-            displayMainMenu();
-            choice = getIntInput();
-            
-            // Handle invalid input
-            if (choice < 0) {
-                std::cout << "Please try again.\n";
-                continue;
-            }
-            
-            switch (choice) {
-                case 1: {
-                    reservationSystem.displayAllTrains();
-                    break;
-                }
-                case 2: {
-                    std::cout << "Enter Train ID: ";
-                    int trainId = getIntInput();
-                    if (trainId > 0) {
-                        reservationSystem.checkSeatAvailability(trainId);
-                    }
-                    break;
-                }
-                case 3: {
-                    std::cout << "Enter Train ID: ";
-                    int trainId = getIntInput();
-                    if (trainId <= 0) {
-                        break;
-                    }
-                    
-                    std::string passengerName;
-                    std::cout << "Enter Passenger Name: ";
-                    std::getline(std::cin, passengerName);
-                    
-                    if (passengerName.empty()) {
-                        std::cerr << "Error: Passenger name cannot be empty.\n";
-                        break;
-                    }
-                    
-                    std::string result = reservationSystem.bookTicket(trainId, passengerName);
-                    if (result.empty()) {
-                        std::cout << "Ticket booking failed.\n";
-                    }
-                    break;
-                }
-                case 4: {
-                    std::string bookingId;
-                    std::cout << "Enter Booking ID: ";
-                    std::getline(std::cin, bookingId);
-                    
-                    if (bookingId.empty()) {
-                        std::cerr << "Error: Booking ID cannot be empty.\n";
-                        break;
-                    }
-                    
-                    reservationSystem.cancelTicket(bookingId);
-                    break;
-                }
-                case 5: {
-                    std::string bookingId;
-                    std::cout << "Enter Booking ID: ";
-                    std::getline(std::cin, bookingId);
-                    
-                    if (bookingId.empty()) {
-                        std::cerr << "Error: Booking ID cannot be empty.\n";
-                        break;
-                    }
-                    
-                    reservationSystem.checkTicketStatus(bookingId);
-                    break;
-                }
-                case 0:
-                    // Save data to CSV files before exiting
-                    try {
-                        reservationSystem.saveTrainsToCSV("trains.csv");
-                    } catch (const FileIOException& e) {
-                        std::cerr << "Error: " << e.what() << std::endl;
-                        std::cerr << "Train data was not saved." << std::endl;
-                    }
-                    
-                    try {
-                        reservationSystem.saveTicketsToCSV("tickets.csv");
-                    } catch (const FileIOException& e) {
-                        std::cerr << "Error: " << e.what() << std::endl;
-                        std::cerr << "Ticket data was not saved." << std::endl;
-                    }
-                    
-                    std::cout << "Thank you for using Railway Reservation System. Goodbye!\n";
-                    break;
-                default:
-                    std::cout << "Invalid choice. Please enter a number between 0 and 5.\n";
-            }
-            
-        } while (choice != 0);
-        
-    } catch (const std::exception& e) {
-        std::cerr << "Critical error: " << e.what() << std::endl;
-        std::cerr << "The application will now exit." << std::endl;
-        return 1;
-    } catch (...) {
-        std::cerr << "Unknown critical error occurred. The application will now exit." << std::endl;
-        return 1;
-    }
-    
-    return 0;
-}
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <fstream>
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <cassert>
+#include <cstring>
+#include <string_view>
+#include <charconv>
+#include <optional>
+#include <utility>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <cerrno>
+#include <iterator>
+
+// Custom exceptions
+class TrainNotFoundException : public std::runtime_error {
+public:
+    TrainNotFoundException(int id) : 
+        std::runtime_error("Train with ID " + std::to_string(id) + " not found!") {}
+};
+
+class SeatNotFoundException : public std::runtime_error {
+public:
+    SeatNotFoundException(int trainId, int seatNo) : 
+        std::runtime_error("Seat number " + std::to_string(seatNo) + 
+                         " on train " + std::to_string(trainId) + " is invalid!") {}
+};
+
+class NoSeatsAvailableException : public std::runtime_error {
+public:
+    NoSeatsAvailableException(int trainId) : 
+        std::runtime_error("No seats available on train " + std::to_string(trainId) + "!") {}
+};
+
+class NoContiguousSeatsException : public std::runtime_error {
+public:
+    NoContiguousSeatsException(int trainId, int count) : 
+        std::runtime_error("No " + std::to_string(count) + " adjacent seats available on train " + 
+                         std::to_string(trainId) + "!") {}
+};
+
+class StopNotFoundException : public std::runtime_error {
+public:
+    StopNotFoundException(int trainId, const std::string& stop) : 
+        std::runtime_error("Stop '" + stop + "' is not on the route of train " + std::to_string(trainId) + "!") {}
+};
+
+class TicketNotFoundException : public std::runtime_error {
+public:
+    TicketNotFoundException(const std::string& bookingId) : 
+        std::runtime_error("Ticket with booking ID " + bookingId + " not found!") {}
+};
+
+class TrainBusyException : public std::runtime_error {
+public:
+    TrainBusyException(int trainId) : 
+        std::runtime_error("Train " + std::to_string(trainId) + 
+                         " has too many bookings waiting; please try again shortly!") {}
+};
+
+class FileIOException : public std::runtime_error {
+public:
+    FileIOException(const std::string& filename, const std::string& operation) : 
+        std::runtime_error("Failed to " + operation + " file: " + filename) {}
+};
+
+class SnapshotFormatException : public std::runtime_error {
+public:
+    SnapshotFormatException(const std::string& filename, const std::string& problem) : 
+        std::runtime_error("Snapshot file " + filename + ": " + problem) {}
+};
+
+class BookingIdsExhaustedException : public std::runtime_error {
+public:
+    BookingIdsExhaustedException() : 
+        std::runtime_error("Every booking ID has been issued; no more bookings can be made!") {}
+};
+
+class InvalidInputException : public std::runtime_error {
+public:
+    InvalidInputException(const std::string& message) : 
+        std::runtime_error("Invalid input: " + message) {}
+};
+
+// Journey dates are stored as yyyymmdd integers so they order chronologically
+int makeDate(const tm& t) {
+    return (t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
+}
+
+// Reentrant localtime; the plain one shares a static buffer between threads
+tm localTime(time_t when) {
+    tm t = tm();
+#if defined(_MSC_VER)
+    localtime_s(&t, &when);
+#else
+    localtime_r(&when, &t);
+#endif
+    return t;
+}
+
+int todayDate() {
+    return makeDate(localTime(time(0)));
+}
+
+int addDays(int date, int days) {
+    tm t = tm();
+    t.tm_year = date / 10000 - 1900;
+    t.tm_mon = date / 100 % 100 - 1;
+    t.tm_mday = date % 100 + days;
+    t.tm_hour = 12; // stay clear of DST transitions at midnight
+    mktime(&t);
+    return makeDate(t);
+}
+
+std::string formatDate(int date) {
+    std::stringstream ss;
+    ss << std::setfill('0') << std::setw(4) << date / 10000 << "-"
+       << std::setw(2) << date / 100 % 100 << "-"
+       << std::setw(2) << date % 100;
+    return ss.str();
+}
+
+inline int daysInMonth(int year, int month) {
+    static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return (month == 2 && leap) ? 29 : days[month - 1];
+}
+
+// Parses a whole field as a decimal integer without throwing; false if it is
+// empty, holds anything else or does not fit
+inline bool parseIntField(std::string_view field, int& value) {
+    const char* end = field.data() + field.size();
+    std::from_chars_result result = std::from_chars(field.data(), end, value);
+    return !field.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+enum class DateParse { Ok, BadFormat, NoSuchDate };
+
+// Parses YYYY-MM-DD without throwing, rejecting dates that do not exist
+inline DateParse parseDateField(std::string_view text, int& date) {
+    int year, month, day;
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-' || !parseIntField(text.substr(0, 4), year) ||
+        !parseIntField(text.substr(5, 2), month) || !parseIntField(text.substr(8, 2), day)) {
+        return DateParse::BadFormat;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+        return DateParse::NoSuchDate;
+    }
+    date = year * 10000 + month * 100 + day;
+    return DateParse::Ok;
+}
+
+// Throwing form of parseDateField, for dates typed by the user
+int parseDate(const std::string& text) {
+    int date = 0;
+    switch (parseDateField(text, date)) {
+        case DateParse::BadFormat:  throw InvalidInputException("date must be in YYYY-MM-DD format: " + text);
+        case DateParse::NoSuchDate: throw InvalidInputException("no such date: " + text);
+        case DateParse::Ok:         break;
+    }
+    return date;
+}
+
+// Index of the lowest set bit; word must be non-zero
+inline int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    int index = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Number of set bits in a word
+inline int countSetBits(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    while (word) {
+        word &= word - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Seat map for a capacity known at compile time. The seat words and a single
+// summary word live inline in the object, and every loop and bound is a
+// compile-time constant. Bit layout matches SeatBitmap's first two levels.
+template <int N>
+class FixedSeatBitmap {
+public:
+    static const int BITS_PER_WORD = 64;
+    static const int WORDS = (N + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    static_assert(N > 0 && WORDS <= BITS_PER_WORD, "one summary word covers at most 64 seat words");
+
+private:
+    uint64_t summary;
+    uint64_t words[WORDS];
+
+public:
+    // Marks every seat available
+    void fill() {
+        for (int w = 0; w < WORDS; w++) {
+            words[w] = ~0ULL;
+        }
+        if (N % BITS_PER_WORD != 0) {
+            words[WORDS - 1] = (1ULL << (N % BITS_PER_WORD)) - 1;
+        }
+        summary = (WORDS == BITS_PER_WORD) ? ~0ULL : (1ULL << (WORDS % BITS_PER_WORD)) - 1;
+    }
+
+    int size() const { return N; }
+    size_t wordCount() const { return WORDS; }
+    uint64_t word(size_t w) const { return words[w]; }
+
+    // Replaces every seat word with a saved copy and rebuilds the summary
+    void assignWords(const uint64_t* source) {
+        std::memcpy(words, source, sizeof(words));
+        summary = 0;
+        for (int w = 0; w < WORDS; w++) {
+            if (words[w] != 0) {
+                summary |= 1ULL << w;
+            }
+        }
+    }
+
+    bool test(int index) const {
+        return (words[index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+    }
+
+    void set(int index) {
+        words[index / BITS_PER_WORD] |= 1ULL << (index % BITS_PER_WORD);
+        summary |= 1ULL << (index / BITS_PER_WORD);
+    }
+
+    void reset(int index) {
+        uint64_t& word = words[index / BITS_PER_WORD];
+        word &= ~(1ULL << (index % BITS_PER_WORD));
+        if (word == 0) {
+            summary &= ~(1ULL << (index / BITS_PER_WORD));
+        }
+    }
+
+    int count() const {
+        int total = 0;
+        for (int w = 0; w < WORDS; w++) {
+            total += countSetBits(words[w]);
+        }
+        return total;
+    }
+
+    int findFirst() const {
+        if (summary == 0) {
+            return -1;
+        }
+        int w = countTrailingZeros(summary);
+        return w * BITS_PER_WORD + countTrailingZeros(words[w]);
+    }
+
+    int findNext(int from) const {
+        if (from < 0) from = 0;
+        if (from >= N) return -1;
+        
+        int w = from / BITS_PER_WORD;
+        uint64_t word = words[w] & (~0ULL << (from % BITS_PER_WORD));
+        if (word != 0) {
+            return w * BITS_PER_WORD + countTrailingZeros(word);
+        }
+        uint64_t later = (w + 1 < BITS_PER_WORD) ? summary & (~0ULL << (w + 1)) : 0;
+        if (later == 0) {
+            return -1;
+        }
+        w = countTrailingZeros(later);
+        return w * BITS_PER_WORD + countTrailingZeros(words[w]);
+    }
+};
+
+// Forwards a SeatBitmap call to its inline fixed-capacity map, if it has one
+#define SEAT_BITMAP_DISPATCH(call)                        \
+    switch (storage) {                                    \
+        case FIXED_72:   return fixed72.call;             \
+        case FIXED_100:  return fixed100.call;            \
+        case FIXED_864:  return fixed864.call;            \
+        case FIXED_1200: return fixed1200.call;           \
+        case DYNAMIC:    break;                           \
+    }
+
+// Seat map packed into 64-bit words (a set bit means the seat is available).
+// Fleet capacities (72, 100, 864 and 1200 seats) use an inline
+// FixedSeatBitmap chosen at construction, so their seat words sit inside the
+// owning Train. Any other size uses heap-allocated words with summary levels
+// above them, in which bit i is set when word i of the level below has any
+// bit set, up to a single top word. Searches descend from the top, so
+// finding a free seat costs O(log64 seats) word reads.
+class SeatBitmap {
+private:
+    enum Storage { DYNAMIC, FIXED_72, FIXED_100, FIXED_864, FIXED_1200 };
+    
+    int bitCount;
+    Storage storage;
+    union {
+        FixedSeatBitmap<72> fixed72;
+        FixedSeatBitmap<100> fixed100;
+        FixedSeatBitmap<864> fixed864;
+        FixedSeatBitmap<1200> fixed1200;
+    };
+    std::vector<std::vector<uint64_t> > levels; // DYNAMIC only; levels[0] holds the seats
+
+    // Recompute the summary levels from the seat words
+    void buildSummary() {
+        levels.resize(1);
+        while (levels.back().size() > 1) {
+            const std::vector<uint64_t>& below = levels.back();
+            std::vector<uint64_t> summary((below.size() + BITS_PER_WORD - 1) / BITS_PER_WORD, 0);
+            for (size_t w = 0; w < below.size(); w++) {
+                if (below[w] != 0) {
+                    summary[w / BITS_PER_WORD] |= 1ULL << (w % BITS_PER_WORD);
+                }
+            }
+            levels.push_back(summary);
+        }
+    }
+
+    // Index of the first set bit in the subtree under bit pos of the given level
+    int descend(size_t level, int pos) const {
+        while (level > 0) {
+            level--;
+            pos = pos * BITS_PER_WORD + countTrailingZeros(levels[level][pos]);
+        }
+        return pos;
+    }
+
+public:
+    static const int BITS_PER_WORD = 64;
+
+    explicit SeatBitmap(int bits = 0) : bitCount(bits), storage(DYNAMIC) {
+        switch (bits) {
+            case 72:   storage = FIXED_72;   fixed72.fill();   return;
+            case 100:  storage = FIXED_100;  fixed100.fill();  return;
+            case 864:  storage = FIXED_864;  fixed864.fill();  return;
+            case 1200: storage = FIXED_1200; fixed1200.fill(); return;
+        }
+        
+        std::vector<uint64_t> words((bits + BITS_PER_WORD - 1) / BITS_PER_WORD, ~0ULL);
+        // Padding bits past the last seat stay clear so scans never return them
+        if (bits % BITS_PER_WORD != 0) {
+            words.back() = (1ULL << (bits % BITS_PER_WORD)) - 1;
+        }
+        levels.push_back(words);
+        buildSummary();
+    }
+
+    int size() const { return bitCount; }
+    
+    size_t wordCount() const {
+        SEAT_BITMAP_DISPATCH(wordCount())
+        return levels[0].size();
+    }
+    
+    uint64_t word(size_t w) const {
+        SEAT_BITMAP_DISPATCH(word(w))
+        return levels[0][w];
+    }
+
+    // Replaces every seat word with a saved copy of wordCount() words
+    void assignWords(const uint64_t* source) {
+        SEAT_BITMAP_DISPATCH(assignWords(source))
+        std::memcpy(levels[0].data(), source, levels[0].size() * sizeof(uint64_t));
+        buildSummary();
+    }
+
+    bool test(int index) const {
+        SEAT_BITMAP_DISPATCH(test(index))
+        return (levels[0][index / BITS_PER_WORD] >> (index % BITS_PER_WORD)) & 1;
+    }
+
+    void set(int index) {
+        SEAT_BITMAP_DISPATCH(set(index))
+        // Walk up only while a word goes from empty to non-empty
+        for (size_t level = 0; level < levels.size(); level++) {
+            uint64_t& word = levels[level][index / BITS_PER_WORD];
+            bool wasEmpty = (word == 0);
+            word |= 1ULL << (index % BITS_PER_WORD);
+            if (!wasEmpty) break;
+            index /= BITS_PER_WORD;
+        }
+    }
+
+    void reset(int index) {
+        SEAT_BITMAP_DISPATCH(reset(index))
+        // Walk up only while a word goes from non-empty to empty
+        for (size_t level = 0; level < levels.size(); level++) {
+            uint64_t& word = levels[level][index / BITS_PER_WORD];
+            word &= ~(1ULL << (index % BITS_PER_WORD));
+            if (word != 0) break;
+            index /= BITS_PER_WORD;
+        }
+    }
+
+    int count() const {
+        SEAT_BITMAP_DISPATCH(count())
+        int total = 0;
+        for (size_t w = 0; w < levels[0].size(); w++) {
+            total += countSetBits(levels[0][w]);
+        }
+        return total;
+    }
+
+    // Returns the index of the first set bit, or -1 if every bit is clear
+    int findFirst() const {
+        SEAT_BITMAP_DISPATCH(findFirst())
+        if (bitCount == 0 || levels.back()[0] == 0) {
+            return -1;
+        }
+        return descend(levels.size() - 1, countTrailingZeros(levels.back()[0]));
+    }
+
+    // Returns the index of the first set bit at or after from, or -1 if none.
+    // Climbs until some level has a set bit to the right, then descends.
+    int findNext(int from) const {
+        SEAT_BITMAP_DISPATCH(findNext(from))
+        if (from < 0) from = 0;
+        if (from >= bitCount) return -1;
+        
+        int pos = from;
+        for (size_t level = 0; level < levels.size(); level++) {
+            size_t w = pos / BITS_PER_WORD;
+            if (w >= levels[level].size()) {
+                return -1;
+            }
+            uint64_t word = levels[level][w] & (~0ULL << (pos % BITS_PER_WORD));
+            if (word != 0) {
+                return descend(level, static_cast<int>(w) * BITS_PER_WORD + countTrailingZeros(word));
+            }
+            // Nothing left in this word; resume at the next word one level up
+            pos = static_cast<int>(w) + 1;
+        }
+        return -1;
+    }
+};
+
+#undef SEAT_BITMAP_DISPATCH
+
+// Seat bitmap whose bits are claimed and released with atomic read-modify-write
+// operations on 64-bit words, so several threads can book one train without a
+// lock. Like SeatBitmap a set bit means the seat is free, but there are no
+// summary levels to keep in step: searches walk the words from a start word
+// the caller picks, which lets concurrent bookers begin in different words.
+class AtomicSeatBitmap {
+private:
+    static const int BITS_PER_WORD = 64;
+    
+    int bitCount;
+    size_t words;
+    std::unique_ptr<std::atomic<uint64_t>[]> bits;
+    std::atomic<int> freeCount; // trails the words by at most one update per thread
+
+    void copyFrom(const AtomicSeatBitmap& other) {
+        bitCount = other.bitCount;
+        words = other.words;
+        bits.reset(new std::atomic<uint64_t>[words]);
+        for (size_t w = 0; w < words; w++) {
+            bits[w].store(other.bits[w].load(std::memory_order_acquire), std::memory_order_relaxed);
+        }
+        freeCount.store(other.freeCount.load());
+    }
+
+public:
+    explicit AtomicSeatBitmap(int size = 0) :
+        bitCount(size), words((size + BITS_PER_WORD - 1) / BITS_PER_WORD),
+        bits(new std::atomic<uint64_t>[words]), freeCount(size) {
+        for (size_t w = 0; w < words; w++) {
+            int used = size - static_cast<int>(w) * BITS_PER_WORD;
+            // Padding bits past the last seat stay clear so claims never return them
+            bits[w].store(used >= BITS_PER_WORD ? ~0ULL : (1ULL << used) - 1, std::memory_order_relaxed);
+        }
+    }
+    
+    AtomicSeatBitmap(const AtomicSeatBitmap& other) : freeCount(0) {
+        copyFrom(other);
+    }
+    
+    AtomicSeatBitmap& operator=(const AtomicSeatBitmap& other) {
+        if (this != &other) {
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    int size() const { return bitCount; }
+    size_t wordCount() const { return words; }
+    
+    uint64_t word(size_t w) const {
+        return bits[w].load(std::memory_order_acquire);
+    }
+
+    // Replaces every seat word with a saved copy; not safe against concurrent claims
+    void assignWords(const uint64_t* source) {
+        int free = 0;
+        for (size_t w = 0; w < words; w++) {
+            uint64_t value;
+            std::memcpy(&value, source + w, sizeof(value));
+            bits[w].store(value, std::memory_order_relaxed);
+            free += countSetBits(value);
+        }
+        freeCount.store(free, std::memory_order_release);
+    }
+
+    bool test(int index) const {
+        return (word(index / BITS_PER_WORD) >> (index % BITS_PER_WORD)) & 1;
+    }
+    
+    int count() const {
+        return freeCount.load(std::memory_order_relaxed);
+    }
+
+    // Clears the bit; returns false if another thread got there first
+    bool claim(int index) {
+        uint64_t bit = 1ULL << (index % BITS_PER_WORD);
+        if ((bits[index / BITS_PER_WORD].fetch_and(~bit, std::memory_order_acq_rel) & bit) == 0) {
+            return false;
+        }
+        freeCount.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Sets the bit; returns false if it was already set
+    bool release(int index) {
+        uint64_t bit = 1ULL << (index % BITS_PER_WORD);
+        if ((bits[index / BITS_PER_WORD].fetch_or(bit, std::memory_order_acq_rel) & bit) != 0) {
+            return false;
+        }
+        freeCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Claims the lowest set bit that is also set in mask (any bit when mask is
+    // null), trying words from startWord onwards and wrapping round. A failed
+    // compare-and-swap retries on the word's new value. Returns the index, or
+    // -1 once a full pass finds nothing.
+    int claimAny(size_t startWord, const std::vector<uint64_t>* mask) {
+        for (size_t i = 0; i < words; i++) {
+            size_t w = (startWord + i) % words;
+            uint64_t filter = mask ? (*mask)[w] : ~0ULL;
+            uint64_t current = bits[w].load(std::memory_order_relaxed);
+            while ((current & filter) != 0) {
+                int offset = countTrailingZeros(current & filter);
+                if (bits[w].compare_exchange_weak(current, current & ~(1ULL << offset),
+                                                  std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    freeCount.fetch_sub(1, std::memory_order_relaxed);
+                    return static_cast<int>(w) * BITS_PER_WORD + offset;
+                }
+            }
+        }
+        return -1;
+    }
+};
+
+// How a train's seat map is shared between threads. Locked maps rely on the
+// caller holding the train's lock and resell seats per leg; lock-free maps
+// are claimed with atomic operations and sell each seat for the whole route.
+enum class SeatMapMode { Locked, LockFree };
+
+// Seat counter written by whoever holds the train's lock and read without it.
+// Relaxed ordering is enough: readers want a recent count, not one that is
+// consistent with other memory. Copies take a snapshot of the value.
+class RelaxedCounter {
+private:
+    std::atomic<int> value;
+
+public:
+    explicit RelaxedCounter(int initial = 0) : value(initial) {}
+    RelaxedCounter(const RelaxedCounter& other) : value(other.load()) {}
+    
+    RelaxedCounter& operator=(const RelaxedCounter& other) {
+        value.store(other.load(), std::memory_order_relaxed);
+        return *this;
+    }
+    
+    int load() const { return value.load(std::memory_order_relaxed); }
+    operator int() const { return load(); }
+    
+    RelaxedCounter& operator++() {
+        value.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+    }
+    
+    RelaxedCounter& operator--() {
+        value.fetch_sub(1, std::memory_order_relaxed);
+        return *this;
+    }
+    
+    void operator++(int) { ++*this; }
+    void operator--(int) { --*this; }
+};
+
+// Seqlock-style version of a group of counters. The holder of the train's
+// lock makes it odd while it changes them and even again after; readers take
+// no lock and retry if the version was odd or moved while they read. Write
+// scopes nest, so only the outermost one bumps the version. Copies take a
+// snapshot of the value.
+class VersionStamp {
+private:
+    std::atomic<unsigned> value;
+    int writeDepth; // touched by the lock holder only
+    
+    void beginWrite() {
+        if (writeDepth++ == 0) {
+            value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+    }
+    
+    void endWrite() {
+        if (--writeDepth == 0) {
+            value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    }
+
+public:
+    // Makes the version odd for the lifetime of the scope
+    class WriteScope {
+    private:
+        VersionStamp& stamp;
+
+    public:
+        explicit WriteScope(VersionStamp& target) : stamp(target) { stamp.beginWrite(); }
+        ~WriteScope() { stamp.endWrite(); }
+        
+        WriteScope(const WriteScope&) = delete;
+        WriteScope& operator=(const WriteScope&) = delete;
+    };
+    
+    VersionStamp() : value(0), writeDepth(0) {}
+    VersionStamp(const VersionStamp& other) : value(other.value.load(std::memory_order_relaxed)), writeDepth(0) {}
+    
+    VersionStamp& operator=(const VersionStamp& other) {
+        value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        writeDepth = 0;
+        return *this;
+    }
+    
+    // Waits out a write in progress and returns the version to validate against
+    unsigned readBegin() const {
+        unsigned version;
+        while ((version = value.load(std::memory_order_acquire)) & 1) {
+            std::this_thread::yield();
+        }
+        return version;
+    }
+    
+    // True if a writer ran since readBegin returned version; the reads in
+    // between must then be retried
+    bool changedSince(unsigned version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return value.load(std::memory_order_relaxed) != version;
+    }
+};
+
+enum class BerthPreference { None, Lower, Middle, Upper, Side };
+const int BERTH_PREFERENCE_COUNT = 5;
+
+// Coaches of berthsPerCoach berths laid out in sleeper bays of eight:
+// LB, MB, UB, LB, MB, UB, SL, SU. The last coach may be partially filled.
+// Which side of the coach a berth faces is not recorded, so there is no
+// window preference; the side berths are the only ones known to be by a window.
+class SeatLayout {
+private:
+    int berthsPerCoach;
+
+public:
+    static const int DEFAULT_BERTHS_PER_COACH = 72;
+    static const int BERTHS_PER_BAY = 8;
+
+    explicit SeatLayout(int berths = DEFAULT_BERTHS_PER_COACH) : berthsPerCoach(berths) {
+        if (berths <= 0) throw InvalidInputException("Berths per coach must be positive");
+    }
+
+    int getBerthsPerCoach() const { return berthsPerCoach; }
+    int getCoachCount(int totalSeats) const { return (totalSeats + berthsPerCoach - 1) / berthsPerCoach; }
+
+    // Coach and berth numbers are 1-based, like seat numbers
+    int coachOf(int seatNumber) const { return (seatNumber - 1) / berthsPerCoach + 1; }
+    int berthOf(int seatNumber) const { return (seatNumber - 1) % berthsPerCoach + 1; }
+
+    std::string berthType(int seatNumber) const {
+        static const char* const names[BERTHS_PER_BAY] = { "LB", "MB", "UB", "LB", "MB", "UB", "SL", "SU" };
+        return names[(berthOf(seatNumber) - 1) % BERTHS_PER_BAY];
+    }
+
+    bool matches(int seatNumber, BerthPreference preference) const {
+        std::string type = berthType(seatNumber);
+        switch (preference) {
+            case BerthPreference::None:   return true;
+            case BerthPreference::Lower:  return type == "LB" || type == "SL";
+            case BerthPreference::Middle: return type == "MB";
+            case BerthPreference::Upper:  return type == "UB" || type == "SU";
+            case BerthPreference::Side:   return type == "SL" || type == "SU";
+        }
+        return false;
+    }
+
+    std::string describe(int seatNumber) const {
+        return "Coach " + std::to_string(coachOf(seatNumber)) + ", Berth " +
+               std::to_string(berthOf(seatNumber)) + " (" + berthType(seatNumber) + ")";
+    }
+};
+
+class Train {
+private:
+    int trainId;
+    std::string trainName;
+    int totalSeats;
+    SeatBitmap seatAvailability; // set bit means seat is free on every leg
+    RelaxedCounter availableSeats; // kept in step with seatAvailability
+    RelaxedCounter heldSeats;      // booked seats reserved by unconfirmed holds
+    VersionStamp countsVersion;    // bumped around changes to the two counters above
+    SeatMapMode seatMapMode;
+    AtomicSeatBitmap atomicSeats; // replaces seatAvailability and the per-leg maps in lock-free mode
+    std::vector<std::string> stops;          // leg i runs from stops[i] to stops[i + 1]
+    std::vector<SeatBitmap> legAvailability; // per-leg seat maps, kept only when there are several legs
+    SeatLayout layout;
+    // Per-preference masks in the same word layout as seatAvailability; a set
+    // bit means the seat has that attribute. Built once and shared by every
+    // copy of the train, so per-date seat maps do not duplicate them.
+    std::shared_ptr<const std::vector<std::vector<uint64_t> > > preferenceMasks;
+    // Free seats matching each preference, kept in step with the end-to-end
+    // free map, so a sold-out preference falls back to any seat at once
+    // instead of after a pass over every free word
+    RelaxedCounter preferenceFree[BERTH_PREFERENCE_COUNT];
+
+    void buildPreferenceMasks() {
+        size_t words = seatWordCount();
+        std::vector<std::vector<uint64_t> > masks(BERTH_PREFERENCE_COUNT, std::vector<uint64_t>(words, 0));
+        for (int p = 1; p < BERTH_PREFERENCE_COUNT; p++) {
+            for (int i = 0; i < totalSeats; i++) {
+                if (layout.matches(i + 1, static_cast<BerthPreference>(p))) {
+                    masks[p][i / SeatBitmap::BITS_PER_WORD] |= 1ULL << (i % SeatBitmap::BITS_PER_WORD);
+                }
+            }
+        }
+        preferenceMasks = std::make_shared<const std::vector<std::vector<uint64_t> > >(masks);
+    }
+
+    // Free seats with preference p in the current end-to-end free map
+    int countPreferenceFree(int p) const {
+        const std::vector<uint64_t>& mask = (*preferenceMasks)[p];
+        int free = 0;
+        for (size_t w = 0; w < seatWordCount(); w++) {
+            free += countSetBits(freeWord(w) & mask[w]);
+        }
+        return free;
+    }
+
+    void recountPreferences() {
+        for (int p = 1; p < BERTH_PREFERENCE_COUNT; p++) {
+            preferenceFree[p] = RelaxedCounter(countPreferenceFree(p));
+        }
+    }
+
+    // Seat index went from taken to free end to end, or the reverse
+    void countPreferences(int index, bool freed) {
+        size_t w = index / SeatBitmap::BITS_PER_WORD;
+        uint64_t bit = 1ULL << (index % SeatBitmap::BITS_PER_WORD);
+        for (int p = 1; p < BERTH_PREFERENCE_COUNT; p++) {
+            if ((*preferenceMasks)[p][w] & bit) {
+                if (freed) {
+                    preferenceFree[p]++;
+                } else {
+                    preferenceFree[p]--;
+                }
+            }
+        }
+    }
+
+    // Lock-free claims and releases; the preference counts trail the seat
+    // words by at most one update per thread, like the free count
+    bool claimAtomic(int index) {
+        if (!atomicSeats.claim(index)) {
+            return false;
+        }
+        countPreferences(index, false);
+        return true;
+    }
+
+    int claimAnyAtomic(const std::vector<uint64_t>* mask) {
+        int index = atomicSeats.claimAny(searchStartWord(), mask);
+        if (index >= 0) {
+            countPreferences(index, false);
+        }
+        return index;
+    }
+
+    bool releaseAtomic(int index) {
+        if (!atomicSeats.release(index)) {
+            return false;
+        }
+        countPreferences(index, true);
+        return true;
+    }
+
+    int legCount() const { return static_cast<int>(stops.size()) - 1; }
+
+    size_t seatWordCount() const {
+        return (totalSeats + SeatBitmap::BITS_PER_WORD - 1) / SeatBitmap::BITS_PER_WORD;
+    }
+
+    // Free-seat word w of whichever seat map the mode uses
+    uint64_t freeWord(size_t w) const {
+        return isLockFree() ? atomicSeats.word(w) : seatAvailability.word(w);
+    }
+
+    // Index of the first free seat at or after index, or -1 if none
+    int nextFreeIndex(int index) const {
+        if (!isLockFree()) {
+            return seatAvailability.findNext(index);
+        }
+        const int bits = SeatBitmap::BITS_PER_WORD;
+        for (size_t w = index / bits; w < seatWordCount(); w++) {
+            uint64_t free = atomicSeats.word(w);
+            if (w == static_cast<size_t>(index / bits)) {
+                free &= ~0ULL << (index % bits);
+            }
+            if (free != 0) {
+                return static_cast<int>(w) * bits + countTrailingZeros(free);
+            }
+        }
+        return -1;
+    }
+
+    // Word a lock-free search starts from, drawn per thread so concurrent
+    // bookers spread over the seat map instead of all racing for the first word
+    size_t searchStartWord() const {
+        static thread_local std::minstd_rand rng(
+            static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+        return rng() % seatWordCount();
+    }
+
+    void checkStopRange(int fromStop, int toStop) const {
+        if (fromStop < 0 || toStop > legCount() || fromStop >= toStop) {
+            throw InvalidInputException("boarding stop must come before alighting stop");
+        }
+    }
+
+    void checkSeatNumber(int seatNumber) const {
+        if (seatNumber < 1 || seatNumber > totalSeats) {
+            throw SeatNotFoundException(trainId, seatNumber);
+        }
+    }
+
+    bool isFreeOnLegs(int index, int fromStop, int toStop) const {
+        if (legAvailability.empty()) return seatAvailability.test(index);
+        for (int leg = fromStop; leg < toStop; leg++) {
+            if (!legAvailability[leg].test(index)) return false;
+        }
+        return true;
+    }
+
+    bool isBookedOnLegs(int index, int fromStop, int toStop) const {
+        if (legAvailability.empty()) return !seatAvailability.test(index);
+        for (int leg = fromStop; leg < toStop; leg++) {
+            if (legAvailability[leg].test(index)) return false;
+        }
+        return true;
+    }
+
+    // Books the seat on legs [fromStop, toStop); it stops being free end to end
+    void takeSeat(int index, int fromStop, int toStop) {
+        for (int leg = fromStop; leg < toStop && !legAvailability.empty(); leg++) {
+            legAvailability[leg].reset(index);
+        }
+        if (seatAvailability.test(index)) {
+            seatAvailability.reset(index);
+            countPreferences(index, false);
+            VersionStamp::WriteScope write(countsVersion);
+            availableSeats--;
+        }
+        checkAvailableCount();
+    }
+
+    void takeSeat(int index) {
+        takeSeat(index, 0, legCount());
+    }
+
+    // Frees the seat on legs [fromStop, toStop); it is free end to end again
+    // once no leg is booked
+    void releaseSeat(int index, int fromStop, int toStop) {
+        for (int leg = fromStop; leg < toStop && !legAvailability.empty(); leg++) {
+            legAvailability[leg].set(index);
+        }
+        if (!seatAvailability.test(index) && (legAvailability.empty() || isFreeOnLegs(index, 0, legCount()))) {
+            seatAvailability.set(index);
+            countPreferences(index, true);
+            VersionStamp::WriteScope write(countsVersion);
+            availableSeats++;
+        }
+        checkAvailableCount();
+    }
+
+    // Debug builds verify the maintained counters against a popcount of the seat map
+    void checkAvailableCount() const {
+        assert(availableSeats == seatAvailability.count());
+#ifndef NDEBUG
+        for (int p = 1; p < BERTH_PREFERENCE_COUNT; p++) {
+            assert(preferenceFree[p] == countPreferenceFree(p));
+        }
+#endif
+    }
+
+public:
+    Train(int id, std::string name, int seats, int berthsPerCoach = SeatLayout::DEFAULT_BERTHS_PER_COACH,
+          std::vector<std::string> route = std::vector<std::string>(),
+          SeatMapMode mode = SeatMapMode::Locked) : 
+        trainId(id), trainName(name), totalSeats(seats), availableSeats(seats), heldSeats(0), seatMapMode(mode),
+        stops(route), layout(berthsPerCoach) {
+        // Validate input parameters
+        if (id <= 0) throw InvalidInputException("Train ID must be positive");
+        if (name.empty()) throw InvalidInputException("Train name cannot be empty");
+        if (seats <= 0) throw InvalidInputException("Number of seats must be positive");
+        
+        // Trains without a route run as a single leg
+        if (stops.empty()) {
+            stops.push_back("Origin");
+            stops.push_back("Destination");
+        }
+        if (stops.size() < 2) throw InvalidInputException("Route must have at least two stops");
+        for (size_t i = 0; i < stops.size(); i++) {
+            if (stops[i].empty()) throw InvalidInputException("Stop name cannot be empty");
+            if (std::find(stops.begin(), stops.begin() + i, stops[i]) != stops.begin() + i) {
+                throw InvalidInputException("Stop " + stops[i] + " appears twice on the route");
+            }
+        }
+        
+        if (isLockFree()) {
+            atomicSeats = AtomicSeatBitmap(totalSeats);
+        } else {
+            seatAvailability = SeatBitmap(totalSeats);
+            if (legCount() > 1) {
+                legAvailability.assign(legCount(), SeatBitmap(totalSeats));
+            }
+        }
+        buildPreferenceMasks();
+        recountPreferences();
+    }
+
+    int getTrainId() const { return trainId; }
+    std::string getTrainName() const { return trainName; }
+    int getTotalSeats() const { return totalSeats; }
+    const SeatLayout& getLayout() const { return layout; }
+    const std::vector<std::string>& getStops() const { return stops; }
+    SeatMapMode getSeatMapMode() const { return seatMapMode; }
+    
+    // Lock-free trains may be booked through bookNextAvailableSeat,
+    // bookPreferredSeat, bookSegmentSeat, bookSpecificSeat and cancelSeat
+    // without holding the train's lock
+    bool isLockFree() const { return seatMapMode == SeatMapMode::LockFree; }
+    
+    int getStopIndex(std::string_view stop) const {
+        for (size_t i = 0; i < stops.size(); i++) {
+            if (stops[i] == stop) return static_cast<int>(i);
+        }
+        throw StopNotFoundException(trainId, std::string(stop));
+    }
+    
+    bool isSeatAvailable(int seatNumber) const {
+        if (seatNumber < 1 || seatNumber > totalSeats) {
+            throw SeatNotFoundException(trainId, seatNumber);
+        }
+        return isLockFree() ? atomicSeats.test(seatNumber - 1) : seatAvailability.test(seatNumber - 1);
+    }
+    
+    int getAvailableSeatsCount() const {
+        return isLockFree() ? atomicSeats.count() : availableSeats;
+    }
+    
+    int getHeldSeatsCount() const {
+        return heldSeats;
+    }
+    
+    // Free and held seat counts as of a single moment, read without the
+    // train's lock; a hold moves a seat from one count to the other, and the
+    // read is retried if that happened while it ran
+    void getSeatCounts(int& available, int& held) const {
+        unsigned version;
+        do {
+            version = countsVersion.readBegin();
+            available = getAvailableSeatsCount();
+            held = heldSeats;
+        } while (countsVersion.changedSince(version));
+    }
+    
+    // A held seat is taken out of the free map like a booking, so allocation
+    // skips it, but is counted apart until the hold is confirmed or released
+    int holdNextAvailableSeat() {
+        VersionStamp::WriteScope write(countsVersion);
+        int seatNumber = bookNextAvailableSeat();
+        heldSeats++;
+        return seatNumber;
+    }
+    
+    void confirmHeldSeat() {
+        VersionStamp::WriteScope write(countsVersion);
+        heldSeats--;
+    }
+    
+    bool releaseHeldSeat(int seatNumber) {
+        VersionStamp::WriteScope write(countsVersion);
+        if (!cancelSeat(seatNumber)) {
+            return false;
+        }
+        heldSeats--;
+        return true;
+    }
+    
+    // Returns the first available seat at or after seatNumber, or -1 if none
+    int findAvailableSeatFrom(int seatNumber) const {
+        int index = nextFreeIndex(seatNumber - 1);
+        return index < 0 ? -1 : index + 1;
+    }
+    
+    int bookNextAvailableSeat() {
+        int index = isLockFree() ? claimAnyAtomic(nullptr) : seatAvailability.findFirst();
+        if (index < 0) {
+            throw NoSeatsAvailableException(trainId);
+        }
+        if (!isLockFree()) {
+            takeSeat(index);
+        }
+        return index + 1; // Seat number (1-based)
+    }
+    
+    // Books the first free seat matching the preference, falling back to any
+    // free seat when none match. Free words are found through the summary
+    // levels and intersected with the preference mask a word at a time. A
+    // preference with no free seat left goes straight to the fallback.
+    int bookPreferredSeat(BerthPreference preference) {
+        if (preference != BerthPreference::None && preferenceFree[static_cast<int>(preference)] <= 0) {
+            return bookNextAvailableSeat();
+        }
+        if (preference != BerthPreference::None && isLockFree()) {
+            int index = claimAnyAtomic(&(*preferenceMasks)[static_cast<int>(preference)]);
+            if (index >= 0) {
+                return index + 1;
+            }
+        } else if (preference != BerthPreference::None) {
+            const std::vector<uint64_t>& mask = (*preferenceMasks)[static_cast<int>(preference)];
+            int index = seatAvailability.findFirst();
+            while (index >= 0) {
+                size_t w = index / SeatBitmap::BITS_PER_WORD;
+                uint64_t candidates = seatAvailability.word(w) & mask[w];
+                if (candidates != 0) {
+                    int seat = static_cast<int>(w) * SeatBitmap::BITS_PER_WORD + countTrailingZeros(candidates);
+                    takeSeat(seat);
+                    return seat + 1;
+                }
+                index = seatAvailability.findNext(static_cast<int>(w + 1) * SeatBitmap::BITS_PER_WORD);
+            }
+        }
+        return bookNextAvailableSeat();
+    }
+    
+    // Books the first seat that is free on every leg from fromStop to toStop.
+    // Candidate words are found through the boarding leg's summary levels and
+    // AND-reduced across the remaining legs a word at a time.
+    int bookSegmentSeat(int fromStop, int toStop) {
+        checkStopRange(fromStop, toStop);
+        // Lock-free seat maps have no per-leg maps and sell the whole seat
+        if (legAvailability.empty() || (fromStop == 0 && toStop == legCount())) {
+            return bookNextAvailableSeat();
+        }
+        
+        const SeatBitmap& boarding = legAvailability[fromStop];
+        int index = boarding.findFirst();
+        while (index >= 0) {
+            size_t w = index / SeatBitmap::BITS_PER_WORD;
+            uint64_t candidates = boarding.word(w);
+            for (int leg = fromStop + 1; leg < toStop && candidates != 0; leg++) {
+                candidates &= legAvailability[leg].word(w);
+            }
+            if (candidates != 0) {
+                int seat = static_cast<int>(w) * SeatBitmap::BITS_PER_WORD + countTrailingZeros(candidates);
+                takeSeat(seat, fromStop, toStop);
+                return seat + 1;
+            }
+            index = boarding.findNext(static_cast<int>(w + 1) * SeatBitmap::BITS_PER_WORD);
+        }
+        throw NoSeatsAvailableException(trainId);
+    }
+    
+    bool bookSpecificSeat(int seatNumber) {
+        return bookSpecificSeat(seatNumber, 0, legCount());
+    }
+    
+    bool bookSpecificSeat(int seatNumber, int fromStop, int toStop) {
+        checkSeatNumber(seatNumber);
+        checkStopRange(fromStop, toStop);
+        if (isLockFree()) {
+            return claimAtomic(seatNumber - 1);
+        }
+        
+        if (isFreeOnLegs(seatNumber - 1, fromStop, toStop)) {
+            takeSeat(seatNumber - 1, fromStop, toStop);
+            return true;
+        }
+        
+        return false; // Seat already booked on some leg
+    }
+    
+    // Returns the first seat of the earliest run of count adjacent free seats
+    // (optionally not crossing a coach boundary), or -1 if there is none.
+    // Each run of free seats is measured once a word at a time, and booked
+    // stretches are skipped through the summary levels.
+    int findContiguousSeats(int count, bool sameCoach) const {
+        const int bits = SeatBitmap::BITS_PER_WORD;
+        if (count <= 0 || count > totalSeats) return -1;
+        if (sameCoach && count > layout.getBerthsPerCoach()) return -1;
+        
+        int start = nextFreeIndex(0);
+        while (start >= 0) {
+            // Find the end of the run: the first booked seat at or after start
+            size_t w = start / bits;
+            uint64_t booked = ~freeWord(w) & (~0ULL << (start % bits));
+            while (booked == 0 && ++w < seatWordCount()) {
+                booked = ~freeWord(w);
+            }
+            int end = (booked == 0) ? totalSeats
+                                    : std::min(totalSeats, static_cast<int>(w) * bits + countTrailingZeros(booked));
+            
+            if (sameCoach) {
+                // Split the run [start, end) at coach boundaries
+                int berths = layout.getBerthsPerCoach();
+                for (int piece = start; piece < end; ) {
+                    int pieceEnd = std::min(end, (piece / berths + 1) * berths);
+                    if (pieceEnd - piece >= count) return piece + 1;
+                    piece = pieceEnd;
+                }
+            } else if (end - start >= count) {
+                return start + 1;
+            }
+            
+            start = (end < totalSeats) ? nextFreeIndex(end) : -1;
+        }
+        return -1;
+    }
+    
+    // Books count adjacent seats and returns the first seat number
+    int bookContiguousSeats(int count, bool sameCoach) {
+        if (isLockFree()) {
+            // Another thread may claim a seat between the search and the claims,
+            // so roll back what was claimed and search again if that happens
+            for (;;) {
+                int first = findContiguousSeats(count, sameCoach);
+                if (first < 0) {
+                    throw NoContiguousSeatsException(trainId, count);
+                }
+                int seat = first;
+                while (seat < first + count && claimAtomic(seat - 1)) {
+                    seat++;
+                }
+                if (seat == first + count) {
+                    return first;
+                }
+                for (int claimed = first; claimed < seat; claimed++) {
+                    releaseAtomic(claimed - 1);
+                }
+            }
+        }
+        
+        int first = findContiguousSeats(count, sameCoach);
+        if (first < 0) {
+            throw NoContiguousSeatsException(trainId, count);
+        }
+        for (int seat = first; seat < first + count; seat++) {
+            takeSeat(seat - 1);
+        }
+        return first;
+    }
+    
+    bool cancelSeat(int seatNumber) {
+        return cancelSeat(seatNumber, 0, legCount());
+    }
+    
+    bool cancelSeat(int seatNumber, int fromStop, int toStop) {
+        checkSeatNumber(seatNumber);
+        checkStopRange(fromStop, toStop);
+        if (isLockFree()) {
+            return releaseAtomic(seatNumber - 1);
+        }
+        
+        if (isBookedOnLegs(seatNumber - 1, fromStop, toStop)) {
+            releaseSeat(seatNumber - 1, fromStop, toStop);
+            return true;
+        }
+        
+        return false; // Seat was not booked on every leg of the range
+    }
+    
+    // Seat words in the order exportSeatWords writes them: the end-to-end
+    // free map, then one map per leg when the route has several legs
+    size_t seatMapWordCount() const {
+        return seatWordCount() * (1 + legAvailability.size());
+    }
+    
+    void exportSeatWords(std::vector<uint64_t>& out) const {
+        for (size_t w = 0; w < seatWordCount(); w++) {
+            out.push_back(freeWord(w));
+        }
+        for (const auto& leg : legAvailability) {
+            for (size_t w = 0; w < leg.wordCount(); w++) {
+                out.push_back(leg.word(w));
+            }
+        }
+    }
+    
+    // Replaces the seat maps with seatMapWordCount() saved words; the free
+    // count is recomputed and no seat is left held
+    void importSeatWords(const uint64_t* words) {
+        VersionStamp::WriteScope write(countsVersion);
+        if (isLockFree()) {
+            atomicSeats.assignWords(words);
+        } else {
+            seatAvailability.assignWords(words);
+            for (size_t leg = 0; leg < legAvailability.size(); leg++) {
+                legAvailability[leg].assignWords(words + (leg + 1) * seatWordCount());
+            }
+            availableSeats = RelaxedCounter(seatAvailability.count());
+        }
+        recountPreferences();
+        heldSeats = RelaxedCounter(0);
+    }
+};
+
+// A booking's place in a journey's waitlist, shared by the waitlist and the
+// booking's ticket. The waitlist changes it under the train's lock; status
+// checks read it through the ticket without a lock. The position is the
+// place's rank less the departures from the front of the queue, and the two
+// are read together under the waitlist's version stamp.
+class WaitlistPlace {
+public:
+    // State shared by every place in one waitlist
+    struct Queue {
+        VersionStamp version;             // bumped around changes to ranks and departures
+        std::atomic<int> frontDepartures; // bookings that left from the front
+        
+        Queue() : frontDepartures(0) {}
+    };
+    
+private:
+    std::shared_ptr<Queue> queue;
+    std::atomic<int> rank; // 0 once the booking has left the waitlist
+
+public:
+    WaitlistPlace(std::shared_ptr<Queue> owner, int initialRank) : queue(std::move(owner)), rank(initialRank) {}
+    
+    // Changed by the waitlist only, inside a write scope of the queue's version
+    int getRank() const { return rank.load(std::memory_order_relaxed); }
+    void setRank(int value) { rank.store(value, std::memory_order_relaxed); }
+    
+    // Current 1-based position, or 0 once the booking has left the waitlist
+    int position() const {
+        for (;;) {
+            unsigned version = queue->version.readBegin();
+            int current = rank.load(std::memory_order_relaxed);
+            int departed = queue->frontDepartures.load(std::memory_order_relaxed);
+            if (!queue->version.changedSince(version)) {
+                return current == 0 ? 0 : current - departed;
+            }
+        }
+    }
+};
+
+class Ticket {
+private:
+    std::string bookingId;
+    int trainId;
+    int seatNumber;
+    std::string passengerName;
+    std::string boardingStop;
+    std::string alightingStop;
+    int journeyDate;
+    int waitlistNumber; // waitlist position when booked, 0 if confirmed at booking
+    std::string bookingTime;
+    std::shared_ptr<const WaitlistPlace> waitlistPlace; // set while the ticket is waitlisted
+    
+    void validate() const {
+        if (bookingId.empty()) throw InvalidInputException("Booking ID cannot be empty");
+        if (trainId <= 0) throw InvalidInputException("Train ID must be positive");
+        if (waitlistNumber < 0) throw InvalidInputException("Waitlist number cannot be negative");
+        if (waitlistNumber == 0 && seatNumber <= 0) throw InvalidInputException("Seat number must be positive");
+        if (seatNumber < 0) throw InvalidInputException("Seat number cannot be negative");
+        if (passengerName.empty()) throw InvalidInputException("Passenger name cannot be empty");
+        if (boardingStop.empty()) throw InvalidInputException("Boarding stop cannot be empty");
+        if (alightingStop.empty()) throw InvalidInputException("Alighting stop cannot be empty");
+        if (journeyDate <= 0) throw InvalidInputException("Journey date must be set");
+    }
+    
+    static std::string currentTime() {
+        tm ltm = localTime(time(0));
+        std::stringstream ss;
+        ss << std::setfill('0') 
+           << std::setw(2) << 1 + ltm.tm_mon << "/"
+           << std::setw(2) << ltm.tm_mday << "/"
+           << 1900 + ltm.tm_year << " "
+           << std::setw(2) << ltm.tm_hour << ":"
+           << std::setw(2) << ltm.tm_min << ":"
+           << std::setw(2) << ltm.tm_sec;
+        return ss.str();
+    }
+    
+public:
+    // A waitlisted ticket has seat 0 until a cancellation frees a seat for it
+    Ticket(std::string id, int train, int seat, std::string passenger,
+           std::string boarding, std::string alighting, int date, int waitlist = 0) :
+        bookingId(std::move(id)), trainId(train), seatNumber(seat), passengerName(std::move(passenger)),
+        boardingStop(std::move(boarding)), alightingStop(std::move(alighting)), journeyDate(date),
+        waitlistNumber(waitlist) {
+        validate();
+        bookingTime = currentTime();
+    }
+    
+    // Restores a saved ticket with the booking time it was issued at
+    Ticket(std::string id, int train, int seat, std::string passenger,
+           std::string boarding, std::string alighting, int date, int waitlist, std::string bookedAt) :
+        bookingId(std::move(id)), trainId(train), seatNumber(seat), passengerName(std::move(passenger)),
+        boardingStop(std::move(boarding)), alightingStop(std::move(alighting)), journeyDate(date),
+        waitlistNumber(waitlist), bookingTime(std::move(bookedAt)) {
+        validate();
+    }
+    
+    std::string getBookingId() const { return bookingId; }
+    int getTrainId() const { return trainId; }
+    int getSeatNumber() const { return seatNumber; }
+    std::string getPassengerName() const { return passengerName; }
+    std::string getBoardingStop() const { return boardingStop; }
+    std::string getAlightingStop() const { return alightingStop; }
+    int getJourneyDate() const { return journeyDate; }
+    int getWaitlistNumber() const { return waitlistNumber; }
+    bool isWaitlisted() const { return seatNumber == 0; }
+    std::string getBookingTime() const { return bookingTime; }
+    
+    bool hasWaitlistPlace() const { return waitlistPlace != nullptr; }
+    
+    // Current waitlist position, read without locks; 0 once the ticket has left the waitlist
+    int getCurrentWaitlistPosition() const {
+        return waitlistPlace ? waitlistPlace->position() : 0;
+    }
+    
+    void setWaitlistPlace(std::shared_ptr<const WaitlistPlace> place) {
+        waitlistPlace = std::move(place);
+    }
+    
+    void confirmSeat(int seat) {
+        if (seat <= 0) throw InvalidInputException("Seat number must be positive");
+        seatNumber = seat;
+        waitlistPlace.reset();
+    }
+    
+    void displayTicket() const {
+        std::cout << "\n========== TICKET DETAILS ==========\n";
+        std::cout << "Booking ID: " << bookingId << std::endl;
+        std::cout << "Train ID: " << trainId << std::endl;
+        if (isWaitlisted()) {
+            std::cout << "Seat Number: Waitlisted" << std::endl;
+        } else {
+            std::cout << "Seat Number: " << seatNumber << std::endl;
+        }
+        if (waitlistNumber > 0) {
+            std::cout << "Booked As: WL " << waitlistNumber << std::endl;
+        }
+        std::cout << "Passenger Name: " << passengerName << std::endl;
+        std::cout << "Journey: " << boardingStop << " to " << alightingStop << std::endl;
+        std::cout << "Journey Date: " << formatDate(journeyDate) << std::endl;
+        std::cout << "Booking Time: " << bookingTime << std::endl;
+        std::cout << "===================================\n";
+    }
+};
+
+// FIFO of waitlisted booking IDs for one journey. Each entry has a
+// WaitlistPlace holding its rank: its position plus the number of bookings
+// that had left from the front of the queue when the rank was set. A
+// booking's current position is its rank minus that count, found in O(1)
+// without walking the queue. Promotions leave from the front and only bump
+// the count; a cancellation further back lowers the ranks of the bookings
+// behind it, so it costs O(bookings behind).
+class Waitlist {
+private:
+    std::deque<std::string> entries; // waiting bookings, front first
+    std::unordered_map<std::string, std::shared_ptr<WaitlistPlace> > placeOf;
+    std::shared_ptr<WaitlistPlace::Queue> queue;
+
+public:
+    Waitlist() : queue(std::make_shared<WaitlistPlace::Queue>()) {}
+
+    bool empty() const { return entries.empty(); }
+    int size() const { return static_cast<int>(entries.size()); }
+
+    // Adds the booking at the tail and returns its place, which the
+    // booking's ticket keeps so its position can be read without a lock
+    std::shared_ptr<const WaitlistPlace> join(const std::string& bookingId) {
+        entries.push_back(bookingId);
+        std::shared_ptr<WaitlistPlace> place = std::make_shared<WaitlistPlace>(
+            queue, size() + queue->frontDepartures.load(std::memory_order_relaxed));
+        placeOf[bookingId] = place;
+        return place;
+    }
+
+    const std::string& front() const { return entries.front(); }
+
+    // Calls visit(bookingId, position) for every waiting booking, front first
+    template <typename Visit>
+    void forEachWaiting(Visit visit) const {
+        int position = 0;
+        for (const auto& bookingId : entries) {
+            visit(bookingId, ++position);
+        }
+    }
+
+    bool remove(const std::string& bookingId) {
+        auto it = placeOf.find(bookingId);
+        if (it == placeOf.end()) {
+            return false;
+        }
+        VersionStamp::WriteScope write(queue->version);
+        int departures = queue->frontDepartures.load(std::memory_order_relaxed);
+        int position = it->second->getRank() - departures;
+        it->second->setRank(0);
+        placeOf.erase(it);
+        if (position == 1) {
+            entries.pop_front();
+            queue->frontDepartures.store(departures + 1, std::memory_order_relaxed);
+            return true;
+        }
+        for (size_t i = position; i < entries.size(); i++) {
+            WaitlistPlace& behind = *placeOf[entries[i]];
+            behind.setRank(behind.getRank() - 1);
+        }
+        entries.erase(entries.begin() + (position - 1));
+        return true;
+    }
+};
+
+// One row of the availability board, built from the trains' maintained counters
+struct TrainAvailability {
+    int trainId;
+    std::string trainName;
+    int totalSeats;
+    int availableSeats;
+    int heldSeats;
+};
+
+// Seat reserved while the passenger pays; becomes a ticket on confirmation
+struct SeatHold {
+    std::string holdId;
+    int trainId;
+    int journeyDate;
+    int seatNumber;
+    std::string passengerName;
+    long long expiresAt; // seconds since the epoch
+};
+
+// Seat given to the head of a waitlist when another seat was freed
+struct Promotion {
+    std::string bookingId; // empty if nobody was promoted
+    int seatNumber;
+};
+
+// Outcome of a booking, for callers that report it themselves. A waitlisted
+// booking succeeds with seat 0 and its waitlist position.
+struct BookingResult {
+    bool success = false;
+    std::string bookingId;
+    int seatNumber = 0;
+    int waitlistPosition = 0;
+    bool preferenceMet = true;
+    std::string allocation;               // coach and berth, when a seat was allocated
+    std::shared_ptr<const Ticket> ticket; // set on success
+    bool durable = true;                  // false if the booking log could not be synced
+    std::string error;                    // message line, set on failure
+};
+
+struct CancelResult {
+    bool success = false;
+    bool wasWaitlisted = false;
+    Promotion promotion = Promotion();
+    bool durable = true; // false if the booking log could not be synced
+    std::string error;
+};
+
+struct StatusResult {
+    bool found = false;
+    std::shared_ptr<const Ticket> ticket;
+    int waitlistPosition = 0; // 0 unless the ticket is still waitlisted
+    std::string error;
+};
+
+// Hierarchical timing wheel with one-second ticks. Level k has 64 slots that
+// each span 64^k ticks. A timer sits at the lowest level whose current block
+// contains its deadline and drops to finer levels as its slot comes due, so
+// scheduling is O(1) and each expiry costs amortised O(1) whatever the
+// number of outstanding timers.
+class TimerWheel {
+private:
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+    
+    typedef std::pair<long long, std::string> Timer; // (deadline, id)
+    long long currentTick; // last tick processed
+    size_t timerCount;
+    std::vector<std::vector<Timer> > slots; // LEVELS * SLOTS buckets
+    
+    void place(const Timer& timer) {
+        int level = 0;
+        while (level < LEVELS - 1 &&
+               (timer.first >> (SLOT_BITS * (level + 1))) != (currentTick >> (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        int slot = static_cast<int>((timer.first >> (SLOT_BITS * level)) & (SLOTS - 1));
+        slots[level * SLOTS + slot].push_back(timer);
+    }
+    
+public:
+    explicit TimerWheel(long long now) : currentTick(now), timerCount(0), slots(LEVELS * SLOTS) {}
+    
+    size_t size() const { return timerCount; }
+    
+    void schedule(long long deadline, const std::string& id) {
+        // Deadlines already reached fire on the next tick
+        if (deadline <= currentTick) {
+            deadline = currentTick + 1;
+        }
+        place(Timer(deadline, id));
+        timerCount++;
+    }
+    
+    // Advances to now and appends every timer that came due to expired
+    void advance(long long now, std::vector<Timer>& expired) {
+        while (currentTick < now) {
+            if (timerCount == 0) {
+                currentTick = now;
+                break;
+            }
+            currentTick++;
+            
+            // Entering a new block at level k redistributes that block's slot
+            for (int level = LEVELS - 1; level > 0; level--) {
+                if ((currentTick & ((1LL << (SLOT_BITS * level)) - 1)) == 0) {
+                    int slot = static_cast<int>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+                    std::vector<Timer> due;
+                    due.swap(slots[level * SLOTS + slot]);
+                    for (const auto& timer : due) {
+                        place(timer);
+                    }
+                }
+            }
+            
+            std::vector<Timer>& ready = slots[currentTick & (SLOTS - 1)];
+            timerCount -= ready.size();
+            expired.insert(expired.end(), ready.begin(), ready.end());
+            ready.clear();
+        }
+    }
+};
+
+// Reader slot of the calling thread, shared by every EpochPublisher. A thread
+// claims a slot on its first read and gives it back when it exits; if every
+// slot is taken, new readers wait for a thread to exit.
+class EpochReaderSlots {
+public:
+    static const int MAX_READERS = 256;
+    
+    static int current() {
+        static thread_local Holder holder;
+        return holder.slot;
+    }
+
+private:
+    struct Holder {
+        int slot;
+        Holder() : slot(claim()) {}
+        ~Holder() { taken()[slot].store(false, std::memory_order_release); }
+    };
+    
+    static std::atomic<bool>* taken() {
+        static std::atomic<bool> slots[MAX_READERS]; // zero-initialised: all free
+        return slots;
+    }
+    
+    static int claim() {
+        for (;;) {
+            for (int i = 0; i < MAX_READERS; i++) {
+                bool expected = false;
+                if (!taken()[i].load(std::memory_order_relaxed) &&
+                    taken()[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    return i;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+};
+
+// Epoch-based reclamation for objects shared with readers that take no locks.
+// A reader pins the current epoch in its thread's slot while it uses shared
+// objects. A writer that unlinks an object retires it, stamping it with the
+// epoch before advancing it. The object is freed once every pinned slot is
+// newer than that stamp, so no reader can still hold it.
+class EpochDomain {
+private:
+    static const size_t RECLAIM_BATCH = 32;
+    
+    std::atomic<uint64_t> epoch;                                     // starts at 1; 0 marks an idle slot
+    mutable std::atomic<uint64_t> readerEpochs[EpochReaderSlots::MAX_READERS];
+    std::mutex retireMutex;
+    std::vector<std::pair<uint64_t, std::function<void()> > > retired; // (epoch when retired, deleter)
+
+    // Frees retired objects no pinned reader can still hold; retireMutex is held
+    void reclaim() {
+        uint64_t oldestReader = UINT64_MAX;
+        for (const auto& pinned : readerEpochs) {
+            uint64_t e = pinned.load();
+            if (e != 0 && e < oldestReader) {
+                oldestReader = e;
+            }
+        }
+        
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (retired[i].first < oldestReader) {
+                retired[i].second();
+            } else {
+                retired[kept++] = retired[i];
+            }
+        }
+        retired.resize(kept);
+    }
+
+public:
+    // Pins the current epoch until destruction. Guards nest; an inner guard
+    // leaves the outer pin in place.
+    class ReadGuard {
+    private:
+        const EpochDomain& domain;
+        int slot;
+        bool outermost;
+
+    public:
+        explicit ReadGuard(const EpochDomain& source) : domain(source), slot(EpochReaderSlots::current()) {
+            std::atomic<uint64_t>& pinned = domain.readerEpochs[slot];
+            outermost = pinned.load(std::memory_order_relaxed) == 0;
+            if (outermost) {
+                // Sequentially consistent so a writer's slot scan sees the pin
+                // before this thread can load an object that is being retired
+                pinned.store(domain.epoch.load());
+            }
+        }
+        
+        ~ReadGuard() {
+            if (outermost) {
+                domain.readerEpochs[slot].store(0, std::memory_order_release);
+            }
+        }
+        
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+    
+    EpochDomain() : epoch(1) {
+        for (auto& pinned : readerEpochs) {
+            pinned.store(0, std::memory_order_relaxed);
+        }
+    }
+    
+    // Nothing can be pinned once the owner is being destroyed
+    ~EpochDomain() {
+        for (const auto& entry : retired) {
+            entry.second();
+        }
+    }
+    
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+    
+    // Frees the object once no reader can hold it. It must already be
+    // unreachable for readers that pin after this call.
+    template <typename T>
+    void retire(const T* object) {
+        std::lock_guard<std::mutex> guard(retireMutex);
+        retired.push_back(std::make_pair(epoch.fetch_add(1), std::function<void()>([object]() { delete object; })));
+        if (retired.size() >= RECLAIM_BATCH) {
+            reclaim();
+        }
+    }
+};
+
+// Publishes an immutable object to readers that take no locks. A writer
+// swaps in a replacement and retires the old object through an EpochDomain,
+// so readers never see a torn or freed object.
+template <typename T>
+class EpochPublisher {
+private:
+    EpochDomain domain;
+    std::atomic<const T*> current;
+    std::mutex writerMutex; // serialises writers only
+
+public:
+    // Keeps the object loaded at construction alive until destruction
+    class ReadGuard {
+    private:
+        EpochDomain::ReadGuard pin; // taken before the object is loaded
+        const T* value;
+
+    public:
+        explicit ReadGuard(const EpochPublisher& source) : pin(source.domain), value(source.current.load()) {}
+        
+        const T& operator*() const { return *value; }
+        const T* operator->() const { return value; }
+    };
+    
+    explicit EpochPublisher(std::unique_ptr<const T> initial) : current(initial.release()) {}
+    
+    ~EpochPublisher() {
+        delete current.load();
+    }
+    
+    EpochPublisher(const EpochPublisher&) = delete;
+    EpochPublisher& operator=(const EpochPublisher&) = delete;
+    
+    void publish(std::unique_ptr<const T> next) {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        domain.retire(current.exchange(next.release()));
+    }
+};
+
+// Tickets by booking ID in cache-line-aligned shards chosen by a hash of the
+// ID. Each shard is an open-addressing table with linear probing.
+// - Writers take their shard's mutex; lookups take no lock.
+// - A lookup is validated by the shard's sequence counter (a seqlock) and
+//   retried if a writer changed the shard meanwhile.
+// - Lookups run under an epoch pin, so a ticket record or slot array that a
+//   writer replaces is not freed while a reader may still be looking at it.
+// - Stored tickets are immutable: a change publishes a new copy.
+class BookingTable {
+private:
+    static const size_t SHARD_COUNT = 64;
+    static const size_t INITIAL_CAPACITY = 16;
+    static const uint64_t EMPTY = 0;
+    static const uint64_t TOMBSTONE = 1;
+    
+    struct Slot {
+        std::atomic<uint64_t> tag; // EMPTY, TOMBSTONE, or tagFor(hash of the booking ID)
+        std::atomic<const Ticket*> ticket;
+    };
+    
+    struct Table {
+        size_t capacity; // power of two
+        std::unique_ptr<Slot[]> slots;
+        
+        explicit Table(size_t size) : capacity(size), slots(new Slot[size]) {
+            for (size_t i = 0; i < capacity; i++) {
+                slots[i].tag.store(EMPTY, std::memory_order_relaxed);
+                slots[i].ticket.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+    
+    struct alignas(64) Shard {
+        std::atomic<unsigned> sequence; // odd while a writer is changing the shard
+        std::atomic<Table*> table;
+        std::mutex writeMutex;
+        size_t live;                    // stored tickets; guarded by writeMutex
+        size_t used;                    // stored tickets plus tombstones; guarded by writeMutex
+        
+        Shard() : sequence(0), table(new Table(INITIAL_CAPACITY)), live(0), used(0) {}
+        ~Shard() { delete table.load(); }
+    };
+    
+    EpochDomain epochs;
+    Shard shards[SHARD_COUNT];
+    
+    static size_t hashOf(const std::string& bookingId) {
+        return std::hash<std::string>()(bookingId);
+    }
+    
+    // Never EMPTY or TOMBSTONE
+    static uint64_t tagFor(size_t hash) {
+        return static_cast<uint64_t>(hash) | 2;
+    }
+    
+    // The low bits pick the shard, so probing starts from the bits above them
+    static size_t probeStart(size_t hash, const Table& table) {
+        return (hash / SHARD_COUNT) & (table.capacity - 1);
+    }
+    
+    Shard& shardFor(size_t hash) { return shards[hash % SHARD_COUNT]; }
+    const Shard& shardFor(size_t hash) const { return shards[hash % SHARD_COUNT]; }
+    
+    // Slot holding bookingId, or -1. Safe for readers, which must hold an
+    // epoch pin, and for the writer.
+    static long findSlot(const Table& table, const std::string& bookingId, size_t hash) {
+        uint64_t tag = tagFor(hash);
+        size_t mask = table.capacity - 1;
+        for (size_t i = 0, s = probeStart(hash, table); i < table.capacity; i++, s = (s + 1) & mask) {
+            uint64_t slotTag = table.slots[s].tag.load(std::memory_order_acquire);
+            if (slotTag == EMPTY) {
+                return -1;
+            }
+            if (slotTag == tag) {
+                const Ticket* ticket = table.slots[s].ticket.load(std::memory_order_acquire);
+                if (ticket != nullptr && ticket->getBookingId() == bookingId) {
+                    return static_cast<long>(s);
+                }
+            }
+        }
+        return -1;
+    }
+    
+    // Consistent lookup of the stored record, or null; the caller holds an epoch pin
+    const Ticket* lookup(const Shard& shard, const std::string& bookingId, size_t hash) const {
+        for (;;) {
+            unsigned before = shard.sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            const Table& table = *shard.table.load(std::memory_order_acquire);
+            long slot = findSlot(table, bookingId, hash);
+            const Ticket* ticket = slot < 0 ? nullptr : table.slots[slot].ticket.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shard.sequence.load(std::memory_order_relaxed) == before) {
+                return ticket;
+            }
+        }
+    }
+    
+    // Writers bracket every change with these; writeMutex is held
+    static void beginWrite(Shard& shard) {
+        shard.sequence.store(shard.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    
+    static void endWrite(Shard& shard) {
+        shard.sequence.store(shard.sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    
+    // Stores the record in the first free or tombstoned slot of its probe
+    // sequence; the record's pointer is published before its tag
+    static void place(Table& table, const Ticket* ticket, size_t hash, size_t& used) {
+        size_t mask = table.capacity - 1;
+        size_t s = probeStart(hash, table);
+        while (table.slots[s].tag.load(std::memory_order_relaxed) > TOMBSTONE) {
+            s = (s + 1) & mask;
+        }
+        if (table.slots[s].tag.load(std::memory_order_relaxed) == EMPTY) {
+            used++;
+        }
+        table.slots[s].ticket.store(ticket, std::memory_order_release);
+        table.slots[s].tag.store(tagFor(hash), std::memory_order_release);
+    }
+    
+    // Rehashes into a table at most half full, dropping tombstones; writeMutex is held
+    void grow(Shard& shard) {
+        Table* old = shard.table.load(std::memory_order_relaxed);
+        size_t capacity = INITIAL_CAPACITY;
+        while ((shard.live + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+        
+        Table* table = new Table(capacity);
+        size_t used = 0;
+        for (size_t s = 0; s < old->capacity; s++) {
+            if (old->slots[s].tag.load(std::memory_order_relaxed) > TOMBSTONE) {
+                const Ticket* ticket = old->slots[s].ticket.load(std::memory_order_relaxed);
+                place(*table, ticket, hashOf(ticket->getBookingId()), used);
+            }
+        }
+        
+        beginWrite(shard);
+        shard.table.store(table, std::memory_order_release);
+        shard.used = used;
+        endWrite(shard);
+        epochs.retire(old);
+    }
+
+    // Replaces a stored record with a changed copy; readers keep seeing the old one until it is published
+    template <typename Change>
+    bool update(const std::string& bookingId, Change change) {
+        size_t hash = hashOf(bookingId);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> guard(shard.writeMutex);
+        Table& table = *shard.table.load(std::memory_order_relaxed);
+        long slot = findSlot(table, bookingId, hash);
+        if (slot < 0) {
+            return false;
+        }
+
+        const Ticket* old = table.slots[slot].ticket.load(std::memory_order_relaxed);
+        Ticket* changed = new Ticket(*old);
+        change(*changed);
+        beginWrite(shard);
+        table.slots[slot].ticket.store(changed, std::memory_order_release);
+        endWrite(shard);
+        epochs.retire(old);
+        return true;
+    }
+
+    // Tombstones slot s and retires its record; writeMutex is held inside a write
+    void eraseSlot(Shard& shard, Table& table, size_t s) {
+        const Ticket* ticket = table.slots[s].ticket.load(std::memory_order_relaxed);
+        table.slots[s].tag.store(TOMBSTONE, std::memory_order_release);
+        table.slots[s].ticket.store(nullptr, std::memory_order_release);
+        shard.live--;
+        epochs.retire(ticket);
+    }
+    
+public:
+    ~BookingTable() {
+        for (auto& shard : shards) {
+            Table* table = shard.table.load();
+            for (size_t s = 0; s < table->capacity; s++) {
+                if (table->slots[s].tag.load() > TOMBSTONE) {
+                    delete table->slots[s].ticket.load();
+                }
+            }
+        }
+    }
+    
+    // Returns false if a ticket with the same booking ID already exists.
+    // Takes the ticket by value, so callers done with theirs can move it in.
+    bool insert(Ticket ticket) {
+        size_t hash = hashOf(ticket.getBookingId());
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> guard(shard.writeMutex);
+        if (findSlot(*shard.table.load(std::memory_order_relaxed), ticket.getBookingId(), hash) >= 0) {
+            return false;
+        }
+        if ((shard.used + 1) * 4 > shard.table.load(std::memory_order_relaxed)->capacity * 3) {
+            grow(shard);
+        }
+        
+        const Ticket* record = new Ticket(std::move(ticket));
+        beginWrite(shard);
+        place(*shard.table.load(std::memory_order_relaxed), record, hash, shard.used);
+        shard.live++;
+        endWrite(shard);
+        return true;
+    }
+    
+    // Returns a copy, since the stored ticket may be replaced once the pin is dropped
+    Ticket find(const std::string& bookingId) const {
+        EpochDomain::ReadGuard pin(epochs);
+        size_t hash = hashOf(bookingId);
+        const Ticket* ticket = lookup(shardFor(hash), bookingId, hash);
+        if (ticket == nullptr) {
+            throw TicketNotFoundException(bookingId);
+        }
+        return *ticket;
+    }
+    
+    bool contains(const std::string& bookingId) const {
+        EpochDomain::ReadGuard pin(epochs);
+        size_t hash = hashOf(bookingId);
+        return lookup(shardFor(hash), bookingId, hash) != nullptr;
+    }
+    
+    bool erase(const std::string& bookingId) {
+        size_t hash = hashOf(bookingId);
+        Shard& shard = shardFor(hash);
+        std::lock_guard<std::mutex> guard(shard.writeMutex);
+        Table& table = *shard.table.load(std::memory_order_relaxed);
+        long slot = findSlot(table, bookingId, hash);
+        if (slot < 0) {
+            return false;
+        }
+        beginWrite(shard);
+        eraseSlot(shard, table, slot);
+        endWrite(shard);
+        return true;
+    }
+    
+    bool confirmSeat(const std::string& bookingId, int seatNumber) {
+        return update(bookingId, [seatNumber](Ticket& ticket) { ticket.confirmSeat(seatNumber); });
+    }
+    
+    bool setWaitlistPlace(const std::string& bookingId, std::shared_ptr<const WaitlistPlace> place) {
+        return update(bookingId, [&place](Ticket& ticket) { ticket.setWaitlistPlace(place); });
+    }
+    
+    // Drops every ticket for a journey before the given date; returns how many
+    size_t eraseBefore(int journeyDate) {
+        size_t erased = 0;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard.writeMutex);
+            Table& table = *shard.table.load(std::memory_order_relaxed);
+            beginWrite(shard);
+            for (size_t s = 0; s < table.capacity; s++) {
+                if (table.slots[s].tag.load(std::memory_order_relaxed) > TOMBSTONE &&
+                    table.slots[s].ticket.load(std::memory_order_relaxed)->getJourneyDate() < journeyDate) {
+                    eraseSlot(shard, table, s);
+                    erased++;
+                }
+            }
+            endWrite(shard);
+        }
+        return erased;
+    }
+    
+    void clear() {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard.writeMutex);
+            Table& table = *shard.table.load(std::memory_order_relaxed);
+            beginWrite(shard);
+            for (size_t s = 0; s < table.capacity; s++) {
+                if (table.slots[s].tag.load(std::memory_order_relaxed) > TOMBSTONE) {
+                    eraseSlot(shard, table, s);
+                }
+            }
+            endWrite(shard);
+        }
+    }
+    
+    // Keeps every ticket record alive while it exists, even records that are
+    // replaced or erased meanwhile; it belongs to the thread that made it
+    class Pin {
+    private:
+        EpochDomain::ReadGuard guard;
+        
+    public:
+        explicit Pin(const BookingTable& table) : guard(table.epochs) {}
+    };
+    
+    // Every stored ticket record, valid while the pin lives; each shard is
+    // read consistently, but not all at one instant
+    std::vector<const Ticket*> records(const Pin&) const {
+        std::vector<const Ticket*> all;
+        std::vector<const Ticket*> found;
+        for (const auto& shard : shards) {
+            for (;;) {
+                unsigned before = shard.sequence.load(std::memory_order_acquire);
+                if (before & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                found.clear();
+                const Table& table = *shard.table.load(std::memory_order_acquire);
+                for (size_t s = 0; s < table.capacity; s++) {
+                    if (table.slots[s].tag.load(std::memory_order_acquire) > TOMBSTONE) {
+                        const Ticket* ticket = table.slots[s].ticket.load(std::memory_order_acquire);
+                        if (ticket != nullptr) {
+                            found.push_back(ticket);
+                        }
+                    }
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (shard.sequence.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+            all.insert(all.end(), found.begin(), found.end());
+        }
+        return all;
+    }
+    
+    // Copies every ticket, with the same consistency as records
+    std::vector<Ticket> snapshot() const {
+        Pin pin(*this);
+        std::vector<Ticket> tickets;
+        for (const Ticket* ticket : records(pin)) {
+            tickets.push_back(*ticket);
+        }
+        return tickets;
+    }
+};
+
+// Issues booking IDs that are unique by construction, so no lookup or retry
+// is needed. Each ID encodes a serial number: seconds since 2024 in the high
+// bits, so a restarted process carries on past the IDs it issued before, and a
+// count within that second in the low bits. Threads take serials from a shared
+// counter in blocks, so most IDs touch no shared state. A keyed permutation then
+// scatters the serials over all 36^8 IDs so consecutive bookings share no
+// visible pattern; being a permutation it keeps distinct serials distinct.
+// The permutation's key is secret and random. useKeyFile keeps it in a file
+// so later runs decode and avoid the IDs issued before; without it each
+// process draws its own. When the serials run out of the 36^8 IDs, about
+// 21 years after 2024, no more IDs are issued rather than reusing old ones.
+
+class BookingIdGenerator {
+private:
+    static const int ID_LENGTH = 8;
+    // 36^8, the number of distinct 8-character IDs
+    static const uint64_t ID_SPACE = 2821109907456ULL;
+    // Serials per second of wall-clock time before the counter runs ahead of the clock
+    static const int SERIAL_SECOND_BITS = 12;
+    // 2024-01-01 00:00:00 UTC
+    static const long long SERIAL_EPOCH = 1704067200LL;
+    static const uint64_t BLOCK_SIZE = 64;
+    // The permutation is a Feistel network over 42-bit blocks, the smallest even width covering ID_SPACE
+    static const int HALF_BITS = 21;
+    static const int ROUNDS = 4;
+    
+    static uint64_t randomKey() {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) ^ device();
+    }
+    
+    // Set once, before the first ID is issued or decoded
+    static uint64_t& key() {
+        static uint64_t value = randomKey();
+        return value;
+    }
+    
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+    
+    static uint64_t feistel(uint64_t block) {
+        const uint64_t mask = (1ULL << HALF_BITS) - 1;
+        uint64_t left = block >> HALF_BITS;
+        uint64_t right = block & mask;
+        for (int round = 0; round < ROUNDS; round++) {
+            uint64_t next = left ^ (mix(right ^ mix(key() + round)) & mask);
+            left = right;
+            right = next;
+        }
+        return (left << HALF_BITS) | right;
+    }
+    
+    static uint64_t unfeistel(uint64_t block) {
+        const uint64_t mask = (1ULL << HALF_BITS) - 1;
+        uint64_t left = block >> HALF_BITS;
+        uint64_t right = block & mask;
+        for (int round = ROUNDS - 1; round >= 0; round--) {
+            uint64_t previous = right ^ (mix(left ^ mix(key() + round)) & mask);
+            right = left;
+            left = previous;
+        }
+        return (left << HALF_BITS) | right;
+    }
+    
+    // Walks the 42-bit permutation until it lands inside the ID space, which
+    // makes it a permutation of [0, ID_SPACE)
+    static uint64_t scramble(uint64_t serial) {
+        uint64_t value = serial;
+        do {
+            value = feistel(value);
+        } while (value >= ID_SPACE);
+        return value;
+    }
+    
+    static uint64_t unscramble(uint64_t value) {
+        do {
+            value = unfeistel(value);
+        } while (value >= ID_SPACE);
+        return value;
+    }
+    
+    static std::atomic<uint64_t>& serialCounter() {
+        static std::atomic<uint64_t> counter(initialSerial());
+        return counter;
+    }
+    
+    static uint64_t initialSerial() {
+        long long seconds = static_cast<long long>(time(0)) - SERIAL_EPOCH;
+        return static_cast<uint64_t>(seconds > 0 ? seconds : 0) << SERIAL_SECOND_BITS;
+    }
+    
+    // Creates the key file with owner-only access and syncs it, since IDs
+    // issued under a key that is then lost could be issued again
+    static bool writeKeyFile(const std::string& filename, const std::string& text) {
+#if defined(_WIN32)
+        int file = _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+        bool written = file >= 0 && _write(file, text.data(), static_cast<unsigned>(text.size())) ==
+                                    static_cast<int>(text.size()) && _commit(file) == 0;
+        if (file >= 0) _close(file);
+#else
+        int file = open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+        bool written = file >= 0 && write(file, text.data(), text.size()) == static_cast<ssize_t>(text.size()) &&
+                       fsync(file) == 0;
+        if (file >= 0) close(file);
+#endif
+        return written;
+    }
+    
+public:
+    // Reads the key from the file, or creates the file with a new random key
+    // if there is none. Call before any ID is issued or loaded.
+    static void useKeyFile(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            std::stringstream text;
+            text << std::hex << std::setw(16) << std::setfill('0') << key() << "\n";
+            if (!writeKeyFile(filename, text.str())) {
+                throw FileIOException(filename, "create booking ID key");
+            }
+            return;
+        }
+        std::string text;
+        uint64_t value = 0;
+        if (!std::getline(file, text) || text.size() != 16 ||
+            std::from_chars(text.data(), text.data() + text.size(), value, 16).ptr != text.data() + text.size()) {
+            throw FileIOException(filename, "read booking ID key from");
+        }
+        key() = value;
+    }
+    
+    // Returns prefix followed by 8 characters from [A-Z0-9]. Throws
+    // BookingIdsExhaustedException once every ID has been issued.
+    static std::string next(const char* prefix) {
+        // Serials [next, end) reserved by this thread
+        static thread_local uint64_t blockNext = 0;
+        static thread_local uint64_t blockEnd = 0;
+        if (blockNext == blockEnd) {
+            blockNext = serialCounter().fetch_add(BLOCK_SIZE, std::memory_order_relaxed);
+            blockEnd = blockNext + BLOCK_SIZE;
+        }
+        if (blockNext >= ID_SPACE) {
+            throw BookingIdsExhaustedException();
+        }
+        uint64_t value = scramble(blockNext++);
+        
+        static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+        std::string id(prefix);
+        id.resize(id.size() + ID_LENGTH);
+        for (int i = 0; i < ID_LENGTH; i++) {
+            id[id.size() - 1 - i] = chars[value % 36];
+            value /= 36;
+        }
+        return id;
+    }
+    
+    // Moves the counter past the serial of an ID issued by an earlier run, so
+    // a process restarted within the same second cannot issue it again. Call
+    // for every loaded ID before issuing any. IDs that are not in this format,
+    // or decode to a serial more than a day ahead of the clock, are ignored.
+    static void reserveIssued(std::string_view id) {
+        if (id.size() < static_cast<size_t>(ID_LENGTH)) {
+            return;
+        }
+        uint64_t value = 0;
+        for (size_t i = id.size() - ID_LENGTH; i < id.size(); i++) {
+            char c = id[i];
+            int digit = c >= 'A' && c <= 'Z' ? c - 'A' : c >= '0' && c <= '9' ? c - '0' + 26 : -1;
+            if (digit < 0) {
+                return;
+            }
+            value = value * 36 + digit;
+        }
+        
+        uint64_t serial = unscramble(value) + 1;
+        if (serial > initialSerial() + (86400ULL << SERIAL_SECOND_BITS)) {
+            return;
+        }
+        std::atomic<uint64_t>& counter = serialCounter();
+        uint64_t current = counter.load();
+        while (current < serial && !counter.compare_exchange_weak(current, serial)) {
+        }
+    }
+};
+
+// One change to the bookings, as stored in the write-ahead log
+struct LogRecord {
+    enum Type : uint8_t { TicketIssued = 1, TicketCancelled = 2, SeatConfirmed = 3 };
+    
+    Type type;
+    std::string bookingId;
+    // The rest is set for TicketIssued; SeatConfirmed sets seatNumber only
+    int trainId = 0;
+    int seatNumber = 0;
+    std::string passengerName;
+    std::string boardingStop;
+    std::string alightingStop;
+    int journeyDate = 0;
+    int waitlistNumber = 0;
+};
+
+// Append-only binary log of booking changes, split into numbered segment
+// files "<path>.1", "<path>.2", ... A checkpoint starts a new segment, saves
+// the tickets, then records in "<path>.checkpoint" the first segment it does
+// not cover and deletes the ones before it, so only changes since the last
+// checkpoint are ever replayed.
+// A segment starts with an 8-byte magic string; each record is its payload
+// length (4 bytes), a CRC-32 of the payload (4 bytes) and the payload: a type
+// byte then fields, integers as 4 little-endian bytes and strings as a 2-byte
+// length and their bytes.
+// Appends go to a memory buffer. A flusher thread writes the buffer and calls
+// fdatasync once for every record appended meanwhile (group commit), waiting
+// up to the durability window after the first one so more can join.
+class WriteAheadLog {
+private:
+    static const char MAGIC[8];
+    
+    std::string basePath;
+    std::string filename;      // current segment
+    int fd;
+    uint64_t firstSegment;     // oldest segment not covered by a checkpoint; guarded by mutex
+    uint64_t activeSegment;    // guarded by mutex
+    uint64_t segmentStart;     // appendedRecords when the active segment began; guarded by mutex
+    std::mutex mutex;
+    std::condition_variable flushNeeded;
+    std::condition_variable durableAdvanced;
+    std::string buffer;        // records not yet written; guarded by mutex
+    uint64_t appendedRecords;  // guarded by mutex
+    uint64_t durableRecords;   // guarded by mutex
+    bool failed;               // a write or sync failed; guarded by mutex
+    bool stopping;             // guarded by mutex
+    bool rotating;             // a new segment is waiting on the flush; guarded by mutex
+    // Callbacks from whenDurable and the record each waits for; guarded by mutex
+    std::vector<std::pair<uint64_t, std::function<void(bool)> > > durableCallbacks;
+    std::chrono::microseconds durabilityWindow;
+    std::atomic<size_t> syncs;
+    std::thread flusher;
+    
+    struct LastAppend {
+        const WriteAheadLog* log;
+        uint64_t record;
+    };
+    
+    static LastAppend& lastAppend() {
+        static thread_local LastAppend last = { nullptr, 0 };
+        return last;
+    }
+    
+    static uint32_t crc32(const char* data, size_t length) {
+        static const std::vector<uint32_t> table = []() {
+            std::vector<uint32_t> entries(256);
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+            return entries;
+        }();
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < length; i++) {
+            crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+    
+    static void putInt(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+    
+    static void putString(std::string& out, const std::string& value) {
+        if (value.size() > 0xFFFF) {
+            throw InvalidInputException("text is too long for the booking log");
+        }
+        out += static_cast<char>(value.size() & 0xFF);
+        out += static_cast<char>(value.size() >> 8);
+        out += value;
+    }
+    
+    // Readers return false when the payload ends early
+    static bool getInt(const std::string& in, size_t& pos, int& value) {
+        if (in.size() - pos < 4) return false;
+        uint32_t bits = 0;
+        for (int i = 0; i < 4; i++) {
+            bits |= static_cast<uint32_t>(static_cast<uint8_t>(in[pos + i])) << (8 * i);
+        }
+        value = static_cast<int>(bits);
+        pos += 4;
+        return true;
+    }
+    
+    static bool getString(const std::string& in, size_t& pos, std::string& value) {
+        if (in.size() - pos < 2) return false;
+        size_t length = static_cast<uint8_t>(in[pos]) | (static_cast<size_t>(static_cast<uint8_t>(in[pos + 1])) << 8);
+        pos += 2;
+        if (in.size() - pos < length) return false;
+        value.assign(in, pos, length);
+        pos += length;
+        return true;
+    }
+    
+    static std::string encode(const LogRecord& record) {
+        std::string payload(1, static_cast<char>(record.type));
+        putString(payload, record.bookingId);
+        if (record.type == LogRecord::TicketIssued) {
+            putInt(payload, record.trainId);
+            putInt(payload, record.seatNumber);
+            putString(payload, record.passengerName);
+            putString(payload, record.boardingStop);
+            putString(payload, record.alightingStop);
+            putInt(payload, record.journeyDate);
+            putInt(payload, record.waitlistNumber);
+        } else if (record.type == LogRecord::SeatConfirmed) {
+            putInt(payload, record.seatNumber);
+        }
+        
+        std::string framed;
+        putInt(framed, static_cast<uint32_t>(payload.size()));
+        putInt(framed, crc32(payload.data(), payload.size()));
+        return framed + payload;
+    }
+    
+    static bool decode(const std::string& payload, LogRecord& record) {
+        size_t pos = 1;
+        record = LogRecord();
+        record.type = static_cast<LogRecord::Type>(payload[0]);
+        if (!getString(payload, pos, record.bookingId)) return false;
+        switch (record.type) {
+            case LogRecord::TicketIssued:
+                return getInt(payload, pos, record.trainId) && getInt(payload, pos, record.seatNumber) &&
+                       getString(payload, pos, record.passengerName) &&
+                       getString(payload, pos, record.boardingStop) &&
+                       getString(payload, pos, record.alightingStop) &&
+                       getInt(payload, pos, record.journeyDate) && getInt(payload, pos, record.waitlistNumber);
+            case LogRecord::TicketCancelled:
+                return true;
+            case LogRecord::SeatConfirmed:
+                return getInt(payload, pos, record.seatNumber);
+        }
+        return false;
+    }
+    
+    static int openForAppend(const std::string& path) {
+#if defined(_WIN32)
+        return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+    }
+    
+    static bool writeAll(int file, const std::string& data) {
+        size_t written = 0;
+        while (written < data.size()) {
+#if defined(_WIN32)
+            int n = _write(file, data.data() + written, static_cast<unsigned>(data.size() - written));
+#else
+            ssize_t n = write(file, data.data() + written, data.size() - written);
+#endif
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+    
+    // Flushes file data, and only the metadata needed to read it back, to disk
+    static bool syncData(int file) {
+#if defined(_WIN32)
+        return _commit(file) == 0;
+#elif defined(__APPLE__)
+        return fsync(file) == 0;
+#else
+        return fdatasync(file) == 0;
+#endif
+    }
+    
+    static bool truncateTo(int file, long long length) {
+#if defined(_WIN32)
+        return _chsize_s(file, length) == 0;
+#else
+        return ftruncate(file, static_cast<off_t>(length)) == 0;
+#endif
+    }
+    
+    static void closeFile(int file) {
+#if defined(_WIN32)
+        _close(file);
+#else
+        close(file);
+#endif
+    }
+    
+    static bool fileExists(const std::string& path) {
+        std::ifstream file(path);
+        return file.is_open();
+    }
+    
+    // Makes a file's creation or renaming durable; Windows has no equivalent
+    static void syncDirectoryOf(const std::string& path) {
+#if !defined(_WIN32)
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        int dir = open(directory.c_str(), O_RDONLY);
+        if (dir >= 0) {
+            fsync(dir);
+            close(dir);
+        }
+#else
+        (void)path;
+#endif
+    }
+    
+    static std::string segmentName(const std::string& path, uint64_t segment) {
+        return path + "." + std::to_string(segment);
+    }
+    
+    static std::string manifestName(const std::string& path) {
+        return path + ".checkpoint";
+    }
+    
+    // First segment the last checkpoint did not cover
+    static uint64_t readFirstSegment(const std::string& path) {
+        std::ifstream manifest(manifestName(path));
+        uint64_t segment = 1;
+        if (manifest.is_open() && !(manifest >> segment)) {
+            throw FileIOException(manifestName(path), "read");
+        }
+        return segment;
+    }
+    
+    // Opens a segment for appending and makes sure it starts with the magic string
+    static int openSegment(const std::string& path) {
+        int file = openForAppend(path);
+        if (file < 0) {
+            throw FileIOException(path, "open");
+        }
+        std::ifstream existing(path, std::ios::binary | std::ios::ate);
+        if (existing.tellg() == 0) {
+            if (!(writeAll(file, std::string(MAGIC, sizeof(MAGIC))) && syncData(file))) {
+                closeFile(file);
+                throw FileIOException(path, "write to");
+            }
+            syncDirectoryOf(path);
+        }
+        return file;
+    }
+    
+    // Replays one segment; see replay
+    template <typename Apply>
+    static size_t replaySegment(const std::string& path, Apply& apply) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw FileIOException(path, "open");
+        }
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        if (contents.empty()) {
+            return 0;
+        }
+        if (contents.size() < sizeof(MAGIC) || contents.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+            throw FileIOException(path, "recognise write-ahead log");
+        }
+        
+        size_t pos = sizeof(MAGIC);
+        size_t records = 0;
+        while (contents.size() - pos >= 8) {
+            int length = 0;
+            int checksum = 0;
+            size_t header = pos;
+            getInt(contents, header, length);
+            getInt(contents, header, checksum);
+            if (length <= 0 || contents.size() - header < static_cast<size_t>(length) ||
+                crc32(contents.data() + header, length) != static_cast<uint32_t>(checksum)) {
+                break;
+            }
+            LogRecord record;
+            if (!decode(contents.substr(header, length), record)) {
+                break;
+            }
+            apply(record);
+            records++;
+            pos = header + length;
+        }
+        
+        if (pos < contents.size()) {
+            int segment = openForAppend(path);
+            bool cut = segment >= 0 && truncateTo(segment, static_cast<long long>(pos)) && syncData(segment);
+            if (segment >= 0) {
+                closeFile(segment);
+            }
+            if (!cut) {
+                throw FileIOException(path, "truncate");
+            }
+            std::cerr << "Warning: Dropped " << contents.size() - pos << " byte(s) of incomplete records from "
+                      << path << std::endl;
+        }
+        return records;
+    }
+    
+    void run() {
+        std::unique_lock<std::mutex> guard(mutex);
+        for (;;) {
+            flushNeeded.wait(guard, [this]() { return stopping || !buffer.empty(); });
+            if (buffer.empty()) {
+                return;
+            }
+            if (!stopping && !rotating && durabilityWindow.count() > 0) {
+                // Give concurrent commits the window to join this sync
+                flushNeeded.wait_for(guard, durabilityWindow, [this]() { return stopping || rotating; });
+            }
+            
+            std::string batch;
+            batch.swap(buffer);
+            uint64_t batchEnd = appendedRecords;
+            guard.unlock();
+            bool ok = writeAll(fd, batch) && syncData(fd);
+            guard.lock();
+            
+            if (!ok && !failed) {
+                std::cerr << "Error: " << FileIOException(filename, "write to").what()
+                          << ". Bookings and cancellations are refused from now on." << std::endl;
+            }
+            failed = failed || !ok;
+            durableRecords = batchEnd;
+            syncs++;
+            durableAdvanced.notify_all();
+            
+            if (!durableCallbacks.empty()) {
+                auto waiting = std::partition(durableCallbacks.begin(), durableCallbacks.end(),
+                    [this](const std::pair<uint64_t, std::function<void(bool)> >& callback) {
+                        return callback.first > durableRecords;
+                    });
+                std::vector<std::pair<uint64_t, std::function<void(bool)> > > due(
+                    std::make_move_iterator(waiting), std::make_move_iterator(durableCallbacks.end()));
+                durableCallbacks.erase(waiting, durableCallbacks.end());
+                bool written = !failed;
+                guard.unlock();
+                for (auto& callback : due) {
+                    callback.second(written);
+                }
+                guard.lock();
+            }
+        }
+    }
+    
+public:
+    // Default durability window: how long a commit may wait for others to share its sync
+    static const int DEFAULT_WINDOW_MICROS = 2000;
+    
+    // Appends to a new segment after any left from earlier runs, which are
+    // kept until the next checkpoint, so replay them first
+    WriteAheadLog(const std::string& path, std::chrono::microseconds window) :
+        basePath(path), fd(-1), firstSegment(readFirstSegment(path)), activeSegment(0), segmentStart(0),
+        appendedRecords(0), durableRecords(0), failed(false), stopping(false), rotating(false),
+        durabilityWindow(window), syncs(0) {
+        activeSegment = firstSegment;
+        while (fileExists(segmentName(path, activeSegment))) {
+            activeSegment++;
+        }
+        filename = segmentName(path, activeSegment);
+        fd = openSegment(filename);
+        flusher = std::thread(&WriteAheadLog::run, this);
+    }
+    
+    // Writes and syncs whatever is still buffered
+    ~WriteAheadLog() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        flushNeeded.notify_one();
+        flusher.join();
+        closeFile(fd);
+    }
+    
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+    
+    // Buffers a record; it is durable once waitDurable returns for it
+    void append(const LogRecord& record) {
+        std::string framed = encode(record);
+        uint64_t number;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            buffer += framed;
+            number = ++appendedRecords;
+        }
+        flushNeeded.notify_one();
+        lastAppend().log = this;
+        lastAppend().record = number;
+    }
+    
+    // Blocks until every record the calling thread appended is on disk;
+    // false if the log could not be written
+    bool waitDurable() {
+        if (lastAppend().log != this) {
+            return true;
+        }
+        uint64_t number = lastAppend().record;
+        lastAppend().log = nullptr;
+        std::unique_lock<std::mutex> guard(mutex);
+        durableAdvanced.wait(guard, [this, number]() { return durableRecords >= number; });
+        return !failed;
+    }
+    
+    // Non-blocking waitDurable: calls done, from the flusher thread, once
+    // every record the calling thread appended is on disk, with false if the
+    // log could not be written. done runs at once if they already are.
+    // Returns false, without calling done, if the thread has nothing waiting.
+    bool whenDurable(std::function<void(bool)> done) {
+        if (lastAppend().log != this) {
+            return false;
+        }
+        uint64_t number = lastAppend().record;
+        lastAppend().log = nullptr;
+        bool written;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (durableRecords < number) {
+                durableCallbacks.push_back(std::make_pair(number, std::move(done)));
+                return true;
+            }
+            written = !failed;
+        }
+        done(written);
+        return true;
+    }
+    
+    // True once a write or sync has failed; records appended since may not be on disk
+    bool hasFailed() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return failed;
+    }
+    
+    // True if records were appended, or replayed from earlier runs, since the
+    // last checkpoint
+    bool hasUncheckpointedRecords() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return firstSegment != activeSegment || appendedRecords != segmentStart;
+    }
+    
+    // Sends later appends to a new segment once every record appended so far
+    // is durable; returns the new segment's number
+    uint64_t startSegment() {
+        std::unique_lock<std::mutex> guard(mutex);
+        rotating = true;
+        flushNeeded.notify_one();
+        durableAdvanced.wait(guard, [this]() { return durableRecords == appendedRecords; });
+        rotating = false;
+        
+        // The flusher is idle until the next append, which waits for the mutex
+        std::string nextName = segmentName(basePath, activeSegment + 1);
+        int next = openSegment(nextName);
+        closeFile(fd);
+        fd = next;
+        filename = nextName;
+        activeSegment++;
+        segmentStart = appendedRecords;
+        return activeSegment;
+    }
+    
+    // Records that a checkpoint covers every segment before the given one,
+    // then deletes those segments
+    void dropSegmentsBefore(uint64_t segment) {
+        std::string manifest = manifestName(basePath);
+        {
+            std::ofstream file(manifest + ".tmp");
+            file << segment << "\n";
+            if (file.fail()) {
+                throw FileIOException(manifest + ".tmp", "write to");
+            }
+        }
+        replaceDurably(manifest + ".tmp", manifest);
+        
+        std::lock_guard<std::mutex> guard(mutex);
+        for (; firstSegment < segment; firstSegment++) {
+            std::remove(segmentName(basePath, firstSegment).c_str());
+        }
+    }
+    
+    // Syncs a finished file and renames it over the target, so a crash
+    // leaves either the old or the new contents there
+    static void replaceDurably(const std::string& from, const std::string& to) {
+        int file = openForAppend(from);
+        bool synced = file >= 0 && syncData(file);
+        if (file >= 0) {
+            closeFile(file);
+        }
+        if (!synced) {
+            throw FileIOException(from, "sync");
+        }
+#if defined(_WIN32)
+        // rename does not replace an existing file on Windows
+        std::remove(to.c_str());
+#endif
+        if (std::rename(from.c_str(), to.c_str()) != 0) {
+            throw FileIOException(to, "replace");
+        }
+        syncDirectoryOf(to);
+    }
+    
+    size_t syncCount() const {
+        return syncs;
+    }
+    
+    // Reads every intact record of the segments a checkpoint has not covered,
+    // in order. A torn or corrupt tail, as a crash mid-write leaves, ends its
+    // segment and is cut off. Returns the records read.
+    template <typename Apply>
+    static size_t replay(const std::string& path, Apply apply) {
+        size_t records = 0;
+        for (uint64_t segment = readFirstSegment(path); fileExists(segmentName(path, segment)); segment++) {
+            records += replaySegment(segmentName(path, segment), apply);
+        }
+        return records;
+    }
+};
+
+const char WriteAheadLog::MAGIC[8] = { 'R', 'R', 'W', 'A', 'L', '0', '0', '1' };
+
+// Binary snapshot of the train catalog, the seat maps of every journey and
+// every ticket, written at each checkpoint and loaded at startup in place of
+// the CSV files. A fixed header is followed by arrays of fixed-width records
+// and a heap of the strings they refer to, each starting on an 8-byte
+// boundary, so a mapped file is read in place. Seat maps are stored as the
+// words the seat bitmaps hold in memory and are copied in bulk rather than
+// rebooked seat by seat. Integers are in the writer's byte order, which the
+// header records; a checksum covers everything after the header.
+struct SnapshotSection {
+    uint64_t count;  // records, or bytes for the string heap
+    uint64_t offset; // from the start of the file
+};
+
+struct SnapshotHeader {
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+    
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder; // BYTE_ORDER_MARK as the writer stored it
+    uint32_t headerSize;
+    uint32_t reserved;
+    uint64_t fileSize;
+    uint64_t checksum;  // of every byte after the header
+    SnapshotSection trains;
+    SnapshotSection stops;     // one string per stop; each train's route is a run of them
+    SnapshotSection journeys;
+    SnapshotSection seatWords;
+    SnapshotSection tickets;
+    SnapshotSection strings;
+};
+
+const char SnapshotHeader::MAGIC[8] = { 'R', 'R', 'S', 'N', 'A', 'P', '0', '1' };
+
+// Bytes [offset, offset + length) of the string heap
+struct SnapshotString {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SnapshotTrain {
+    int32_t trainId;
+    int32_t totalSeats;
+    int32_t berthsPerCoach;
+    uint32_t lockFree;
+    SnapshotString name;
+    uint32_t firstStop;
+    uint32_t stopCount;
+};
+
+// Seat words [firstWord, firstWord + wordCount), in Train::exportSeatWords order
+struct SnapshotJourney {
+    int32_t trainId;
+    int32_t journeyDate;
+    uint64_t firstWord;
+    uint64_t wordCount;
+};
+
+struct SnapshotTicket {
+    SnapshotString bookingId;
+    SnapshotString passengerName;
+    SnapshotString boardingStop;
+    SnapshotString alightingStop;
+    SnapshotString bookingTime;
+    int32_t trainId;
+    int32_t seatNumber;
+    int32_t journeyDate;
+    int32_t waitlistNumber;
+    int32_t waitlistPosition; // 0 unless the ticket is still waiting
+    int32_t reserved;
+};
+
+static_assert(sizeof(SnapshotHeader) == 136, "snapshot header layout changed");
+static_assert(sizeof(SnapshotTrain) == 32, "snapshot train record layout changed");
+static_assert(sizeof(SnapshotJourney) == 24, "snapshot journey record layout changed");
+static_assert(sizeof(SnapshotTicket) == 64, "snapshot ticket record layout changed");
+
+// Hash of a byte range taken a 64-bit word at a time. Each step is a
+// bijection of the running value, so a change to any single word always
+// changes the result; per byte it costs a fraction of the log's CRC-32.
+inline uint64_t snapshotChecksum(const char* data, size_t size) {
+    const uint64_t multiplier = 0xFF51AFD7ED558CCDULL;
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ size;
+    size_t words = size / sizeof(uint64_t);
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word;
+        std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(word));
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + words * sizeof(uint64_t), size % sizeof(uint64_t));
+    hash = (hash ^ tail) * multiplier;
+    return hash ^ (hash >> 29);
+}
+
+// Read-only view of a whole file, 8-byte aligned. POSIX systems map the
+// file; elsewhere it is read into memory.
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+#if defined(_WIN32)
+    std::vector<uint64_t> buffer;
+#endif
+
+public:
+    explicit MappedFile(const std::string& filename) : bytes(nullptr), length(0) {
+#if defined(_WIN32)
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw FileIOException(filename, "open");
+        }
+        length = static_cast<size_t>(file.tellg());
+        buffer.resize(length / sizeof(uint64_t) + 1);
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(buffer.data()), length)) {
+            throw FileIOException(filename, "read");
+        }
+        bytes = reinterpret_cast<const char*>(buffer.data());
+#else
+        int file = open(filename.c_str(), O_RDONLY);
+        if (file < 0) {
+            throw FileIOException(filename, "open");
+        }
+        struct stat info;
+        if (fstat(file, &info) != 0) {
+            close(file);
+            throw FileIOException(filename, "read");
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapped == MAP_FAILED) {
+                close(file);
+                throw FileIOException(filename, "map");
+            }
+            bytes = static_cast<const char*>(mapped);
+        }
+        close(file);
+#endif
+    }
+    
+    ~MappedFile() {
+#if !defined(_WIN32)
+        if (bytes != nullptr) {
+            munmap(const_cast<char*>(bytes), length);
+        }
+#endif
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Collects the records of a snapshot and writes them as one file. Stop
+// names, train names and booking times repeat across many records and are
+// stored once; other strings are appended as they come.
+class SnapshotWriter {
+private:
+    std::vector<SnapshotTrain> trains;
+    std::vector<SnapshotString> stops;
+    std::vector<SnapshotJourney> journeys;
+    std::vector<uint64_t> seatWords;
+    std::vector<SnapshotTicket> tickets;
+    std::string strings;
+    std::unordered_map<std::string, SnapshotString> interned;
+    bool heapFull;
+    
+    SnapshotString append(const std::string& text) {
+        SnapshotString stored = { static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(text.size()) };
+        if (strings.size() + text.size() > std::numeric_limits<uint32_t>::max()) {
+            heapFull = true;
+            stored.offset = 0;
+            stored.length = 0;
+            return stored;
+        }
+        strings += text;
+        return stored;
+    }
+    
+    SnapshotString intern(const std::string& text) {
+        auto it = interned.find(text);
+        if (it != interned.end()) {
+            return it->second;
+        }
+        SnapshotString stored = append(text);
+        interned.emplace(text, stored);
+        return stored;
+    }
+    
+    // Appends a section's records at the next 8-byte boundary
+    static void place(std::string& file, SnapshotSection& section, const void* records, size_t bytes) {
+        file.resize((file.size() + 7) / 8 * 8, '\0');
+        section.offset = file.size();
+        file.append(static_cast<const char*>(records), bytes);
+    }
+    
+public:
+    SnapshotWriter() : heapFull(false) {}
+    
+    void addTrain(const Train& train) {
+        SnapshotTrain record = SnapshotTrain();
+        record.trainId = train.getTrainId();
+        record.totalSeats = train.getTotalSeats();
+        record.berthsPerCoach = train.getLayout().getBerthsPerCoach();
+        record.lockFree = train.isLockFree() ? 1 : 0;
+        record.name = intern(train.getTrainName());
+        record.firstStop = static_cast<uint32_t>(stops.size());
+        record.stopCount = static_cast<uint32_t>(train.getStops().size());
+        for (const auto& stop : train.getStops()) {
+            stops.push_back(intern(stop));
+        }
+        trains.push_back(record);
+    }
+    
+    void addJourney(int journeyDate, const Train& journey) {
+        SnapshotJourney record = SnapshotJourney();
+        record.trainId = journey.getTrainId();
+        record.journeyDate = journeyDate;
+        record.firstWord = seatWords.size();
+        journey.exportSeatWords(seatWords);
+        record.wordCount = seatWords.size() - record.firstWord;
+        journeys.push_back(record);
+    }
+    
+    void addTicket(const Ticket& ticket, int waitlistPosition) {
+        SnapshotTicket record = SnapshotTicket();
+        record.bookingId = append(ticket.getBookingId());
+        record.passengerName = append(ticket.getPassengerName());
+        record.boardingStop = intern(ticket.getBoardingStop());
+        record.alightingStop = intern(ticket.getAlightingStop());
+        record.bookingTime = intern(ticket.getBookingTime());
+        record.trainId = ticket.getTrainId();
+        record.seatNumber = ticket.getSeatNumber();
+        record.journeyDate = ticket.getJourneyDate();
+        record.waitlistNumber = ticket.getWaitlistNumber();
+        record.waitlistPosition = waitlistPosition;
+        tickets.push_back(record);
+    }
+    
+    void write(const std::string& filename) const {
+        if (heapFull) {
+            throw SnapshotFormatException(filename, "strings exceed the 4 GB the format can address");
+        }
+        
+        SnapshotHeader header = SnapshotHeader();
+        std::memcpy(header.magic, SnapshotHeader::MAGIC, sizeof(header.magic));
+        header.version = SnapshotHeader::VERSION;
+        header.byteOrder = SnapshotHeader::BYTE_ORDER_MARK;
+        header.headerSize = sizeof(SnapshotHeader);
+        header.trains.count = trains.size();
+        header.stops.count = stops.size();
+        header.journeys.count = journeys.size();
+        header.seatWords.count = seatWords.size();
+        header.tickets.count = tickets.size();
+        header.strings.count = strings.size();
+        
+        std::string file(sizeof(SnapshotHeader), '\0');
+        place(file, header.trains, trains.data(), trains.size() * sizeof(SnapshotTrain));
+        place(file, header.stops, stops.data(), stops.size() * sizeof(SnapshotString));
+        place(file, header.journeys, journeys.data(), journeys.size() * sizeof(SnapshotJourney));
+        place(file, header.seatWords, seatWords.data(), seatWords.size() * sizeof(uint64_t));
+        place(file, header.tickets, tickets.data(), tickets.size() * sizeof(SnapshotTicket));
+        place(file, header.strings, strings.data(), strings.size());
+        file.resize((file.size() + 7) / 8 * 8, '\0');
+        
+        header.fileSize = file.size();
+        header.checksum = snapshotChecksum(file.data() + sizeof(SnapshotHeader), file.size() - sizeof(SnapshotHeader));
+        std::memcpy(&file[0], &header, sizeof(header));
+        
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw FileIOException(filename, "open for writing");
+        }
+        out.write(file.data(), file.size());
+        out.close();
+        if (out.fail()) {
+            throw FileIOException(filename, "write to");
+        }
+    }
+};
+
+// Maps a snapshot and checks it before anything reads it: the magic,
+// version, byte order, size, checksum, and that every section lies inside
+// the file. Records are then read straight from the mapping.
+class SnapshotReader {
+private:
+    std::string filename;
+    MappedFile file;
+    SnapshotHeader header;
+    
+    void checkSection(const SnapshotSection& section, size_t recordSize, const char* name) const {
+        if (section.offset % 8 != 0 || section.offset < sizeof(SnapshotHeader) || section.offset > file.size() ||
+            section.count > (file.size() - section.offset) / recordSize) {
+            throw SnapshotFormatException(filename, std::string("the ") + name + " section is out of bounds");
+        }
+    }
+    
+    template <typename Record>
+    const Record* records(const SnapshotSection& section) const {
+        return reinterpret_cast<const Record*>(file.data() + section.offset);
+    }
+    
+public:
+    explicit SnapshotReader(const std::string& path) : filename(path), file(path) {
+        if (file.size() < sizeof(SnapshotHeader)) {
+            throw SnapshotFormatException(filename, "too short to hold a header");
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, SnapshotHeader::MAGIC, sizeof(header.magic)) != 0) {
+            throw SnapshotFormatException(filename, "not a reservation snapshot");
+        }
+        if (header.version != SnapshotHeader::VERSION || header.headerSize != sizeof(SnapshotHeader)) {
+            throw SnapshotFormatException(filename, "written in unsupported format version " +
+                                                    std::to_string(header.version));
+        }
+        if (header.byteOrder != SnapshotHeader::BYTE_ORDER_MARK) {
+            throw SnapshotFormatException(filename, "written on a machine of the other byte order");
+        }
+        if (header.fileSize != file.size()) {
+            throw SnapshotFormatException(filename, "truncated or extended after it was written");
+        }
+        if (snapshotChecksum(file.data() + sizeof(SnapshotHeader), file.size() - sizeof(SnapshotHeader)) !=
+            header.checksum) {
+            throw SnapshotFormatException(filename, "checksum does not match its contents");
+        }
+        checkSection(header.trains, sizeof(SnapshotTrain), "train");
+        checkSection(header.stops, sizeof(SnapshotString), "stop");
+        checkSection(header.journeys, sizeof(SnapshotJourney), "journey");
+        checkSection(header.seatWords, sizeof(uint64_t), "seat map");
+        checkSection(header.tickets, sizeof(SnapshotTicket), "ticket");
+        checkSection(header.strings, 1, "string");
+    }
+    
+    size_t trainCount() const { return header.trains.count; }
+    size_t journeyCount() const { return header.journeys.count; }
+    size_t ticketCount() const { return header.tickets.count; }
+    
+    const SnapshotTrain& train(size_t i) const { return records<SnapshotTrain>(header.trains)[i]; }
+    const SnapshotJourney& journey(size_t i) const { return records<SnapshotJourney>(header.journeys)[i]; }
+    const SnapshotTicket& ticket(size_t i) const { return records<SnapshotTicket>(header.tickets)[i]; }
+    
+    std::string text(const SnapshotString& stored) const {
+        if (stored.offset > header.strings.count || stored.length > header.strings.count - stored.offset) {
+            throw SnapshotFormatException(filename, "a string lies outside the string heap");
+        }
+        return std::string(file.data() + header.strings.offset + stored.offset, stored.length);
+    }
+    
+    std::vector<std::string> route(const SnapshotTrain& train) const {
+        if (train.firstStop > header.stops.count || train.stopCount > header.stops.count - train.firstStop) {
+            throw SnapshotFormatException(filename, "a route lies outside the stop section");
+        }
+        std::vector<std::string> stops;
+        for (uint32_t i = 0; i < train.stopCount; i++) {
+            stops.push_back(text(records<SnapshotString>(header.stops)[train.firstStop + i]));
+        }
+        return stops;
+    }
+    
+    // The journey's seat words, checked against the size its train expects
+    const uint64_t* seatWords(const SnapshotJourney& journey, size_t expectedWords) const {
+        if (journey.wordCount != expectedWords || journey.firstWord > header.seatWords.count ||
+            journey.wordCount > header.seatWords.count - journey.firstWord) {
+            throw SnapshotFormatException(filename, "the seat map of train " + std::to_string(journey.trainId) +
+                                                    " on " + formatDate(journey.journeyDate) + " is the wrong size");
+        }
+        return records<uint64_t>(header.seatWords) + journey.firstWord;
+    }
+};
+
+// Walks the lines of some text from top to bottom without copying
+class CsvLines {
+private:
+    std::string_view rest;
+
+public:
+    explicit CsvLines(std::string_view text) : rest(text) {}
+    
+    // Next line without its line ending; false at the end of the text
+    bool nextLine(std::string_view& line) {
+        if (rest.empty()) {
+            return false;
+        }
+        const char* newline = static_cast<const char*>(std::memchr(rest.data(), '\n', rest.size()));
+        size_t length = newline ? static_cast<size_t>(newline - rest.data()) : rest.size();
+        line = rest.substr(0, length);
+        rest.remove_prefix(newline ? length + 1 : length);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        return true;
+    }
+    
+    // Cuts the lines not yet read into at most count pieces of about the
+    // same size, each ending at a line boundary
+    std::vector<std::string_view> split(size_t count) const {
+        std::vector<std::string_view> pieces;
+        std::string_view text = rest;
+        for (size_t left = count; left > 0 && !text.empty(); left--) {
+            size_t cut = text.size();
+            if (left > 1) {
+                size_t newline = text.find('\n', text.size() / left);
+                cut = newline == std::string_view::npos ? text.size() : newline + 1;
+            }
+            pieces.push_back(text.substr(0, cut));
+            text.remove_prefix(cut);
+        }
+        return pieces;
+    }
+    
+    size_t remainingSize() const {
+        return rest.size();
+    }
+};
+
+// Splits a CSV file into lines without copying: the file is mapped and each
+// line is a string_view into the mapping, valid while the reader lives
+class CsvReader {
+private:
+    MappedFile file;
+    CsvLines lines;
+
+public:
+    explicit CsvReader(const std::string& filename)
+        : file(filename), lines(std::string_view(file.data(), file.size())) {}
+    
+    bool nextLine(std::string_view& line) {
+        return lines.nextLine(line);
+    }
+    
+    std::vector<std::string_view> split(size_t count) const {
+        return lines.split(count);
+    }
+    
+    size_t remainingSize() const {
+        return lines.remainingSize();
+    }
+};
+
+// Walks the comma-separated fields of one line from left to right. Fields
+// are not quoted; the files this program writes never put a comma in one.
+class CsvFields {
+private:
+    std::string_view rest;
+    bool finished;
+
+public:
+    explicit CsvFields(std::string_view line) : rest(line), finished(false) {}
+    
+    // Next field; false once the line is used up
+    bool next(std::string_view& field) {
+        if (finished) {
+            return false;
+        }
+        size_t comma = rest.find(',');
+        if (comma == std::string_view::npos) {
+            field = rest;
+            finished = true;
+            return true;
+        }
+        field = rest.substr(0, comma);
+        rest.remove_prefix(comma + 1);
+        return true;
+    }
+    
+    // Everything not yet returned, commas included
+    std::string_view remainder() const {
+        return finished ? std::string_view() : rest;
+    }
+};
+
+// Lets a checkpoint pause every logged change for a moment, so that the log
+// position and the tickets it records belong to the same instant. A change
+// holds a pass from its log append until it is applied; closing the gate
+// waits for passes already issued and holds new ones back until it reopens.
+// Passes are taken with the train lock already held and must not nest.
+class CheckpointGate {
+private:
+    std::atomic<int> passing;
+    std::atomic<bool> closed;
+    std::mutex mutex;
+    std::mutex closerMutex; // one closer at a time
+    std::condition_variable drained;
+    std::condition_variable reopened;
+    
+    void enter() {
+        for (;;) {
+            // Sequentially consistent on both sides, so either this pass sees
+            // the gate closed or the closer sees this pass
+            passing.fetch_add(1);
+            if (!closed.load()) {
+                return;
+            }
+            leave();
+            std::unique_lock<std::mutex> guard(mutex);
+            reopened.wait(guard, [this]() { return !closed.load(); });
+        }
+    }
+    
+    void leave() {
+        if (passing.fetch_sub(1) == 1 && closed.load()) {
+            std::lock_guard<std::mutex> guard(mutex);
+            drained.notify_all();
+        }
+    }
+    
+public:
+    CheckpointGate() : passing(0), closed(false) {}
+    
+    class Pass {
+    private:
+        CheckpointGate& gate;
+        
+    public:
+        explicit Pass(CheckpointGate& owner) : gate(owner) {
+            gate.enter();
+        }
+        ~Pass() {
+            gate.leave();
+        }
+        
+        Pass(const Pass&) = delete;
+        Pass& operator=(const Pass&) = delete;
+    };
+    
+    // Keeps the gate closed, with no change half applied, until destruction
+    class Closed {
+    private:
+        CheckpointGate& gate;
+        std::lock_guard<std::mutex> closer;
+        
+    public:
+        explicit Closed(CheckpointGate& owner) : gate(owner), closer(owner.closerMutex) {
+            std::unique_lock<std::mutex> guard(gate.mutex);
+            gate.closed.store(true);
+            gate.drained.wait(guard, [this]() { return gate.passing.load() == 0; });
+        }
+        ~Closed() {
+            {
+                std::lock_guard<std::mutex> guard(gate.mutex);
+                gate.closed.store(false);
+            }
+            gate.reopened.notify_all();
+        }
+        
+        Closed(const Closed&) = delete;
+        Closed& operator=(const Closed&) = delete;
+    };
+};
+
+// Mutex guarding one train's journeys. A train actor holds it across a whole
+// batch of requests with lockBatch; meanwhile lock and unlock calls from that
+// thread skip the mutex, so the requests in the batch run unchanged.
+class TrainLock {
+private:
+    std::mutex mutex;
+    // Callers of tryLockBatchOrQueue waiting for the lock, woken one per release
+    std::mutex waitersMutex;
+    std::deque<std::function<void()> > waiters; // guarded by waitersMutex
+    std::atomic<bool> waiting;                  // waiters may be non-empty
+    std::atomic<uint64_t> releases;
+    
+    static const TrainLock*& batchHeld() {
+        static thread_local const TrainLock* held = nullptr;
+        return held;
+    }
+    
+    // Called after every unlock. A waiter reads releases before trying the
+    // lock and checks it again after setting waiting, so either it sees this
+    // release and tries again or this release sees it queued.
+    void released() {
+        releases.fetch_add(1);
+        if (!waiting.load()) {
+            return;
+        }
+        std::function<void()> wake;
+        {
+            std::lock_guard<std::mutex> guard(waitersMutex);
+            if (waiters.empty()) {
+                waiting.store(false);
+                return;
+            }
+            wake = std::move(waiters.front());
+            waiters.pop_front();
+        }
+        wake();
+    }
+    
+public:
+    TrainLock() : waiting(false), releases(0) {}
+    
+    void lock() {
+        if (batchHeld() != this) {
+            mutex.lock();
+        }
+    }
+    
+    void unlock() {
+        if (batchHeld() != this) {
+            mutex.unlock();
+            released();
+        }
+    }
+    
+    void lockBatch() {
+        mutex.lock();
+        batchHeld() = this;
+    }
+    
+    bool tryLockBatch() {
+        if (!mutex.try_lock()) {
+            return false;
+        }
+        batchHeld() = this;
+        return true;
+    }
+    
+    // Takes the lock for a batch and returns true, or, if it is held, queues
+    // wake to run once it is released and returns false; the caller tries
+    // again when woken. wake runs on the releasing thread, so it should only
+    // hand the caller on, not do the work itself.
+    bool tryLockBatchOrQueue(std::function<void()> wake) {
+        for (;;) {
+            uint64_t seen = releases.load();
+            if (tryLockBatch()) {
+                return true;
+            }
+            std::lock_guard<std::mutex> guard(waitersMutex);
+            waiting.store(true);
+            if (releases.load() == seen) {
+                waiters.push_back(std::move(wake));
+                return false;
+            }
+        }
+    }
+    
+    void unlockBatch() {
+        batchHeld() = nullptr;
+        mutex.unlock();
+        released();
+    }
+    
+    // True while the calling thread runs a batch on some train
+    static bool inBatch() {
+        return batchHeld() != nullptr;
+    }
+    
+    // Ends a batch hold, if there is one, on scope exit
+    class BatchRelease {
+    private:
+        TrainLock* lock;
+
+    public:
+        explicit BatchRelease(TrainLock* held) : lock(held) {}
+        ~BatchRelease() {
+            if (lock != nullptr) {
+                lock->unlockBatch();
+            }
+        }
+        
+        BatchRelease(const BatchRelease&) = delete;
+        BatchRelease& operator=(const BatchRelease&) = delete;
+    };
+};
+
+// Safe to call from several threads at once, except the snapshot and CSV
+// loaders and retireJourneysBefore, which replace or drop state and must run
+// before any other call. Seat maps and waitlists are guarded by one lock per train (held
+// per batch rather than per request under runTrainBatch), except
+// that single bookings on lock-free trains claim seats without it, and tickets
+// by the sharded BookingTable. Availability and status reads take no lock:
+// the catalog and the journey index are epoch-published snapshots, seat
+// counts are read under each train's version stamp and tickets under their
+// shard's. Locks are always taken in the order train lock, holdsMutex,
+// checkpoint gate, journeysMutex, booking shard, write-ahead log. With a
+// write-ahead log open, every change is appended under the train lock before
+// it is applied, and the call returns once it is durable; openWriteAheadLog
+// must run alone, like the loaders, while checkpoint may run at any time.
+class ReservationSystem {
+private:
+    // Days ahead of today that tickets can be booked for
+    static const int BOOKING_HORIZON_DAYS = 120;
+    
+    // Catalog of trains, replaced as a whole and read without locks; their
+    // seat maps are never booked and stand in for any journey date that has
+    // no bookings yet
+    typedef EpochPublisher<std::vector<Train> > TrainCatalog;
+    TrainCatalog catalog;
+    // Lock per catalog train, guarding the seat maps and waitlists of all its journeys
+    std::vector<std::unique_ptr<TrainLock> > trainLocks;
+    // The same locks by train ID; rebuilt with the catalog and only read otherwise
+    std::unordered_map<int, TrainLock*> trainLocksById;
+    // Seat maps per (journey date, train ID), created on the first booking for
+    // that date. Keyed by date first so past dates are erased as one range.
+    typedef std::pair<int, int> JourneyKey;
+    std::map<JourneyKey, Train> journeys;
+    // Immutable copy of the journeys map's keys and nodes, republished when a
+    // journey is added or dropped, so lookups of existing journeys take no lock
+    typedef std::map<JourneyKey, Train*> JourneyIndex;
+    typedef EpochPublisher<JourneyIndex> PublishedJourneyIndex;
+    PublishedJourneyIndex journeyIndex;
+    // Waitlists per journey, created when a journey first fills up
+    std::map<JourneyKey, Waitlist> waitlists;
+    // Guards the shape of journeys and waitlists and serialises republishing
+    // journeyIndex; their entries are guarded by the train locks
+    mutable std::mutex journeysMutex;
+    BookingTable bookings;
+    // Unconfirmed seat holds and the wheel that expires them
+    std::unordered_map<std::string, SeatHold> holds;
+    TimerWheel holdExpiry;
+    std::mutex holdsMutex;
+    // Log of ticket changes since the last checkpoint, or null when not logging
+    std::unique_ptr<WriteAheadLog> wal;
+    // Held by every logged change, so a checkpoint can see the tickets and the
+    // log at one instant
+    CheckpointGate changeGate;
+    std::mutex checkpointMutex; // one checkpoint at a time
+    
+    std::string generateBookingId() {
+        return BookingIdGenerator::next("BK");
+    }
+    
+    // Waits on scope exit, after the train lock is released, until the
+    // changes the calling thread logged are durable, and warns if they are not
+    class DurabilityWait {
+    private:
+        ReservationSystem& system;
+        
+    public:
+        explicit DurabilityWait(ReservationSystem& owner) : system(owner) {}
+        ~DurabilityWait() {
+            if (!system.awaitDurable()) {
+                reportNotDurable();
+            }
+        }
+        
+        DurabilityWait(const DurabilityWait&) = delete;
+        DurabilityWait& operator=(const DurabilityWait&) = delete;
+    };
+    
+public:
+    // Seconds a held seat stays reserved while payment completes
+    static const int HOLD_SECONDS = 600;
+    
+    ReservationSystem() :
+        catalog(std::unique_ptr<const std::vector<Train> >(new std::vector<Train>())),
+        journeyIndex(std::unique_ptr<const JourneyIndex>(new JourneyIndex())), holdExpiry(time(0)) {
+        std::unique_ptr<std::vector<Train> > trains(new std::vector<Train>());
+        try {
+            // Initialize with some trains
+            trains->push_back(Train(1001, "Express Delhi", 100, SeatLayout::DEFAULT_BERTHS_PER_COACH,
+                                   {"Mumbai Central", "Surat", "Vadodara", "Kota", "New Delhi"}));
+            trains->push_back(Train(1002, "Mumbai Local", 100, SeatLayout::DEFAULT_BERTHS_PER_COACH,
+                                   {"Churchgate", "Dadar", "Andheri", "Borivali", "Virar"}));
+            trains->push_back(Train(1003, "Chennai Mail", 100, SeatLayout::DEFAULT_BERTHS_PER_COACH,
+                                   {"Mumbai CST", "Pune", "Solapur", "Guntakal", "Chennai Central"}));
+            trains->push_back(Train(1004, "Kolkata Express", 100, SeatLayout::DEFAULT_BERTHS_PER_COACH,
+                                   {"Mumbai CST", "Nagpur", "Raipur", "Tatanagar", "Howrah"}));
+        } catch (const InvalidInputException& e) {
+            std::cerr << "Error during initialization: " << e.what() << std::endl;
+            // In a real application, you might want to log this and take appropriate action
+        }
+        publishCatalog(std::move(trains));
+    }
+    
+    // Snapshot of every train's seat counts on a date; never scans seat maps
+    std::vector<TrainAvailability> getAvailabilityBoard(int journeyDate) const {
+        TrainCatalog::ReadGuard trains(catalog);
+        PublishedJourneyIndex::ReadGuard index(journeyIndex);
+        std::vector<TrainAvailability> board;
+        board.reserve(trains->size());
+        for (const auto& train : *trains) {
+            const Train& journey = findJourney(*trains, *index, train.getTrainId(), journeyDate);
+            TrainAvailability row = { train.getTrainId(), train.getTrainName(), train.getTotalSeats(), 0, 0 };
+            journey.getSeatCounts(row.availableSeats, row.heldSeats);
+            board.push_back(row);
+        }
+        return board;
+    }
+    
+    void displayAllTrains(int journeyDate) {
+        std::vector<TrainAvailability> board = getAvailabilityBoard(journeyDate);
+        if (board.empty()) {
+            std::cout << "No trains available in the system.\n";
+            return;
+        }
+        
+        std::cout << "\n========== AVAILABLE TRAINS ON " << formatDate(journeyDate) << " ==========\n";
+        std::cout << std::left << std::setw(10) << "Train ID"
+                 << std::setw(20) << "Train Name"
+                 << std::setw(15) << "Total Seats"
+                 << std::setw(17) << "Available Seats"
+                 << std::setw(12) << "Held Seats" << std::endl;
+        std::cout << std::string(74, '-') << std::endl;
+        
+        for (const auto& row : board) {
+            std::cout << std::left << std::setw(10) << row.trainId
+                     << std::setw(20) << row.trainName
+                     << std::setw(15) << row.totalSeats
+                     << std::setw(17) << row.availableSeats
+                     << std::setw(12) << row.heldSeats << std::endl;
+        }
+        std::cout << "=====================================\n";
+    }
+    
+    void checkSeatAvailability(int trainId, int journeyDate) {
+        try {
+            TrainCatalog::ReadGuard trains(catalog);
+            PublishedJourneyIndex::ReadGuard index(journeyIndex);
+            const Train& train = findJourney(*trains, *index, trainId, journeyDate);
+            int availableSeats;
+            int heldSeats;
+            train.getSeatCounts(availableSeats, heldSeats);
+            std::cout << "Train " << trainId << " (" << train.getTrainName() << ") has " 
+                      << availableSeats << " seat(s) available out of " 
+                      << train.getTotalSeats() << " for the full route on " << formatDate(journeyDate) << std::endl;
+            if (heldSeats > 0) {
+                std::cout << heldSeats << " more seat(s) are held pending payment.\n";
+            }
+            std::cout << "Route: " << joinStops(train.getStops(), " -> ") << std::endl;
+            
+            if (availableSeats == 0) {
+                std::cout << "Sorry, the train is fully booked end to end; shorter journeys may still have seats.\n";
+            }
+        } catch (const TrainNotFoundException& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+    
+    // Seats free for the whole route of a journey, read without locks
+    int getAvailableSeats(int trainId, int journeyDate) const {
+        TrainCatalog::ReadGuard trains(catalog);
+        PublishedJourneyIndex::ReadGuard index(journeyIndex);
+        return findJourney(*trains, *index, trainId, journeyDate).getAvailableSeatsCount();
+    }
+    
+    std::string bookTicket(int trainId, const std::string& passengerName) {
+        return bookTicket(trainId, todayDate(), passengerName, BerthPreference::None);
+    }
+    
+    std::string bookTicket(int trainId, int journeyDate, const std::string& passengerName,
+                           BerthPreference preference) {
+        BookingResult result = bookSeat(trainId, journeyDate, passengerName, preference);
+        if (!result.success) {
+            std::cerr << result.error << std::endl;
+            return "";
+        }
+        if (!result.durable) {
+            reportNotDurable();
+        }
+        if (result.waitlistPosition > 0) {
+            reportWaitlisted(result);
+            return result.bookingId;
+        }
+        
+        std::cout << "Ticket booked successfully!\n";
+        if (!result.preferenceMet) {
+            std::cout << "Preferred berth not available; allocated the next free seat.\n";
+        }
+        std::cout << "Allocated: " << result.allocation << std::endl;
+        result.ticket->displayTicket();
+        return result.bookingId;
+    }
+    
+    // Books a seat for the whole route, or a waitlist place if the journey is
+    // full, and prints nothing; callers report from the result
+    BookingResult bookSeat(int trainId, int journeyDate, const std::string& passengerName,
+                           BerthPreference preference) {
+        BookingResult result = bookSeatLogged(trainId, journeyDate, passengerName, preference);
+        result.durable = awaitDurable();
+        return result;
+    }
+    
+    // Books a seat for part of the route; the seat stays on sale for the other legs
+    std::string bookTicket(int trainId, int journeyDate, const std::string& fromStop, const std::string& toStop,
+                           const std::string& passengerName) {
+        if (passengerName.empty()) {
+            std::cerr << "Error: Passenger name cannot be empty.\n";
+            return "";
+        }
+        if (!checkBookableDate(journeyDate) || !checkLogWritable()) {
+            return "";
+        }
+        
+        DurabilityWait durable(*this);
+        try {
+            std::unique_lock<TrainLock> trainGuard(trainLock(trainId), std::defer_lock);
+            Train& train = findJourneyRef(trainId, journeyDate);
+            
+            try {
+                int boarding = train.getStopIndex(fromStop);
+                int alighting = train.getStopIndex(toStop);
+                int seatNumber = claimSeat(train, trainGuard,
+                                           [&]() { return train.bookSegmentSeat(boarding, alighting); });
+                if (seatNumber < 0) {
+                    return addToWaitlist(trainId, journeyDate, passengerName, fromStop, toStop);
+                }
+                try {
+                    std::string bookingId = generateBookingId();
+                    Ticket ticket(bookingId, trainId, seatNumber, passengerName, fromStop, toStop, journeyDate);
+                    CheckpointGate::Pass pass(changeGate);
+                    logTicketIssued(ticket);
+                    bookings.insert(ticket);
+                    
+                    std::cout << "Ticket booked successfully!\n";
+                    std::cout << "Allocated: " << train.getLayout().describe(seatNumber) << std::endl;
+                    ticket.displayTicket();
+                    
+                    return bookingId;
+                } catch (const std::runtime_error& e) {
+                    // Undo seat booking if ticket creation fails
+                    train.cancelSeat(seatNumber, boarding, alighting);
+                    std::cerr << "Error creating ticket: " << e.what() << std::endl;
+                    return "";
+                }
+            } catch (const StopNotFoundException& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return "";
+            } catch (const InvalidInputException& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return "";
+            }
+        } catch (const TrainNotFoundException& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return "";
+        }
+    }
+    
+    // Books adjacent seats for every passenger in one call. Either all tickets
+    // are created or none are; returns the booking IDs in passenger order.
+    std::vector<std::string> bookGroupTickets(int trainId, int journeyDate,
+                                              const std::vector<std::string>& passengerNames, bool sameCoach) {
+        std::vector<std::string> bookingIds;
+        if (passengerNames.empty()) {
+            std::cerr << "Error: Group must have at least one passenger.\n";
+            return bookingIds;
+        }
+        for (const auto& name : passengerNames) {
+            if (name.empty()) {
+                std::cerr << "Error: Passenger name cannot be empty.\n";
+                return bookingIds;
+            }
+        }
+        if (!checkBookableDate(journeyDate) || !checkLogWritable()) {
+            return bookingIds;
+        }
+        
+        DurabilityWait durable(*this);
+        try {
+            std::lock_guard<TrainLock> trainGuard(trainLock(trainId));
+            Train& train = findJourneyRef(trainId, journeyDate);
+            int count = static_cast<int>(passengerNames.size());
+            
+            try {
+                int firstSeat = train.bookContiguousSeats(count, sameCoach);
+                
+                try {
+                    // Build every ticket before publishing any of them
+                    std::vector<Ticket> tickets;
+                    for (int i = 0; i < count; i++) {
+                        std::string bookingId = generateBookingId();
+                        tickets.push_back(Ticket(bookingId, trainId, firstSeat + i, passengerNames[i],
+                                                 train.getStops().front(), train.getStops().back(),
+                                                 journeyDate));
+                        bookingIds.push_back(bookingId);
+                    }
+                    
+                    CheckpointGate::Pass pass(changeGate);
+                    for (const auto& ticket : tickets) {
+                        logTicketIssued(ticket);
+                    }
+                    for (const auto& ticket : tickets) {
+                        bookings.insert(ticket);
+                    }
+                    
+                    std::cout << "Group of " << count << " booked successfully!\n";
+                    for (const auto& ticket : tickets) {
+                        std::cout << "Allocated: " << train.getLayout().describe(ticket.getSeatNumber()) << std::endl;
+                        ticket.displayTicket();
+                    }
+                    return bookingIds;
+                } catch (const std::runtime_error& e) {
+                    // Undo all seat bookings if any ticket creation fails
+                    for (int seat = firstSeat; seat < firstSeat + count; seat++) {
+                        train.cancelSeat(seat);
+                    }
+                    std::cerr << "Error creating ticket: " << e.what() << std::endl;
+                    bookingIds.clear();
+                    return bookingIds;
+                }
+            } catch (const NoContiguousSeatsException& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return bookingIds;
+            }
+        } catch (const TrainNotFoundException& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return bookingIds;
+        }
+    }
+    
+    // Reserves the next free full-route seat for HOLD_SECONDS; returns the hold ID
+    std::string holdSeat(int trainId, int journeyDate, const std::string& passengerName) {
+        expireHolds();
+        if (passengerName.empty()) {
+            std::cerr << "Error: Passenger name cannot be empty.\n";
+            return "";
+        }
+        if (!checkBookableDate(journeyDate) || !checkLogWritable()) {
+            return "";
+        }
+        
+        try {
+            std::lock_guard<TrainLock> trainGuard(trainLock(trainId));
+            Train& train = findJourneyRef(trainId, journeyDate);
+            
+            try {
+                SeatHold hold;
+                hold.holdId = BookingIdGenerator::next("HD");
+                hold.seatNumber = train.holdNextAvailableSeat();
+                hold.trainId = trainId;
+                hold.journeyDate = journeyDate;
+                hold.passengerName = passengerName;
+                hold.expiresAt = static_cast<long long>(time(0)) + HOLD_SECONDS;
+                {
+                    std::lock_guard<std::mutex> holdsGuard(holdsMutex);
+                    holds.emplace(hold.holdId, hold);
+                    holdExpiry.schedule(hold.expiresAt, hold.holdId);
+                }
+                
+                std::cout << "Seat " << hold.seatNumber << " (" << train.getLayout().describe(hold.seatNumber)
+                          << ") held as " << hold.holdId << " for " << HOLD_SECONDS / 60 << " minutes.\n";
+                return hold.holdId;
+            } catch (const NoSeatsAvailableException& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return "";
+            } catch (const BookingIdsExhaustedException& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return "";
+            }
+        } catch (const TrainNotFoundException& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return "";
+        }
+    }
+    
+    // Turns a live hold into a ticket on the held seat; returns the booking ID
+    std::string confirmHold(const std::string& holdId) {
+        expireHolds();
+        if (!checkLogWritable()) {
+            return "";
+        }
+        SeatHold hold;
+        if (!takeHold(holdId, hold)) {
+            std::cerr << "Error: Hold " << holdId << " not found or already expired.\n";
+            return "";
+        }
+        
+        DurabilityWait durable(*this);
+        std::lock_guard<TrainLock> trainGuard(trainLock(hold.trainId));
+        Train& train = findJourneyRef(hold.trainId, hold.journeyDate);
+        try {
+            std::string bookingId = generateBookingId();
+            Ticket ticket(bookingId, hold.trainId, hold.seatNumber, hold.passengerName,
+                          train.getStops().front(), train.getStops().back(), hold.journeyDate);
+            CheckpointGate::Pass pass(changeGate);
+            logTicketIssued(ticket);
+            bookings.insert(ticket);
+            train.confirmHeldSeat();
+            
+            std::cout << "Hold confirmed. Ticket booked successfully!\n";
+            ticket.displayTicket();
+            return bookingId;
+        } catch (const std::runtime_error& e) {
+            // The hold is already gone, so its seat goes back on sale
+            releaseHeldSeat(hold);
+            std::cerr << "Error creating ticket: " << e.what() << std::endl;
+            return "";
+        }
+    }
+    
+    bool releaseHold(const std::string& holdId) {
+        expireHolds();
+        SeatHold hold;
+        if (!takeHold(holdId, hold)) {
+            std::cerr << "Error: Hold " << holdId << " not found or already expired.\n";
+            return false;
+        }
+        
+        DurabilityWait durable(*this);
+        std::lock_guard<TrainLock> trainGuard(trainLock(hold.trainId));
+        releaseHeldSeat(hold);
+        std::cout << "Hold " << holdId << " released.\n";
+        return true;
+    }
+    
+    // Releases every hold whose time is up. Only due timers are visited;
+    // confirmed or released holds are skipped when their timer fires.
+    void expireHolds() {
+        std::vector<SeatHold> expiredHolds;
+        {
+            std::lock_guard<std::mutex> holdsGuard(holdsMutex);
+            std::vector<std::pair<long long, std::string> > expired;
+            holdExpiry.advance(time(0), expired);
+            
+            for (const auto& timer : expired) {
+                auto it = holds.find(timer.second);
+                if (it == holds.end() || it->second.expiresAt != timer.first) {
+                    continue;
+                }
+                expiredHolds.push_back(it->second);
+                holds.erase(it);
+            }
+        }
+        
+        // Seats are released after holdsMutex is dropped to keep the lock order
+        DurabilityWait durable(*this);
+        for (const auto& hold : expiredHolds) {
+            std::lock_guard<TrainLock> trainGuard(trainLock(hold.trainId));
+            releaseHeldSeat(hold);
+        }
+    }
+    
+    // Cancelling a confirmed ticket hands its seat to the head of the
+    // journey's waitlist in the same call
+    bool cancelTicket(const std::string& bookingId) {
+        CancelResult result = cancelBooking(bookingId);
+        if (!result.success) {
+            std::cerr << result.error << std::endl;
+            return false;
+        }
+        if (!result.durable) {
+            reportNotDurable();
+        }
+        if (result.wasWaitlisted) {
+            std::cout << "Waitlisted ticket with Booking ID " << bookingId << " cancelled successfully!\n";
+        } else {
+            std::cout << "Ticket with Booking ID " << bookingId << " cancelled successfully!\n";
+            reportPromotion(result.promotion);
+        }
+        return true;
+    }
+    
+    // Cancels a ticket and prints nothing; callers report from the result
+    CancelResult cancelBooking(const std::string& bookingId) {
+        CancelResult result = cancelBookingLogged(bookingId);
+        result.durable = awaitDurable();
+        return result;
+    }
+    
+    // Runs requests for one train back to back under a single hold of its
+    // lock. Calls they make into this system find the lock already held by
+    // their thread, so a batch pays for one lock instead of one per request.
+    void runTrainBatch(int trainId, std::vector<std::function<void()> >& requests) {
+        TrainLock* lock = nullptr;
+        try {
+            lock = &trainLock(trainId);
+        } catch (const TrainNotFoundException&) {
+            // Unknown train: each request reports the error itself
+        }
+        if (lock != nullptr) {
+            lock->lockBatch();
+        }
+        {
+            TrainLock::BatchRelease release(lock);
+            for (auto& request : requests) {
+                request();
+            }
+        }
+        // One durability wait for the whole batch, after the lock is released
+        if (!awaitDurable()) {
+            reportNotDurable();
+        }
+    }
+    
+    // Runs operation under the train's lock if no other thread holds it and
+    // returns true. Otherwise queues wake to run once the lock is released and
+    // returns false, so the caller can try again then. Calls the operation
+    // makes into this system find the lock already held and do not wait for
+    // their changes to be durable; collect that with whenDurable. An unknown
+    // train runs the operation unlocked so it can report the error.
+    template <typename Operation>
+    bool tryRunOnTrain(int trainId, Operation operation, std::function<void()> wake) {
+        TrainLock* lock = nullptr;
+        try {
+            lock = &trainLock(trainId);
+        } catch (const TrainNotFoundException&) {
+            // The operation reports it
+        }
+        if (lock != nullptr && !lock->tryLockBatchOrQueue(std::move(wake))) {
+            return false;
+        }
+        TrainLock::BatchRelease release(lock);
+        operation();
+        return true;
+    }
+    
+    // True if single bookings on the train claim seats without its lock; they
+    // take it only once the journey looks full
+    bool claimsSeatsWithoutLock(int trainId) const {
+        TrainCatalog::ReadGuard trains(catalog);
+        try {
+            return findTrain(*trains, trainId).isLockFree();
+        } catch (const TrainNotFoundException&) {
+            return false;
+        }
+    }
+    
+    // bookSeat without waiting for the booking to be durable; collect that
+    // with whenDurable
+    BookingResult bookSeatWithoutSync(int trainId, int journeyDate, const std::string& passengerName,
+                                      BerthPreference preference) {
+        return bookSeatLogged(trainId, journeyDate, passengerName, preference);
+    }
+    
+    // Calls done once the changes the calling thread logged are durable, with
+    // false if the log could not be written, and returns true; done runs on
+    // the log's flusher thread, or at once if they already are. Returns false
+    // without calling done when there is nothing to wait for.
+    bool whenDurable(std::function<void(bool)> done) {
+        return wal && wal->whenDurable(std::move(done));
+    }
+    
+    // Train a booking is on, or 0 if there is no such booking; lets callers
+    // route requests by train before running them
+    int findBookingTrainId(const std::string& bookingId) const {
+        try {
+            return bookings.find(bookingId).getTrainId();
+        } catch (const TicketNotFoundException&) {
+            return 0;
+        }
+    }
+    
+    bool checkTicketStatus(const std::string& bookingId) {
+        StatusResult result = findTicketStatus(bookingId);
+        if (!result.found) {
+            std::cerr << result.error << std::endl;
+            return false;
+        }
+        
+        std::cout << "Ticket found! Here are the details:\n";
+        result.ticket->displayTicket();
+        if (result.waitlistPosition > 0) {
+            std::cout << "Current Status: WL " << result.waitlistPosition << std::endl;
+        }
+        return true;
+    }
+    
+    // Looks up a ticket and its waitlist position and prints nothing. Takes no
+    // lock: the position is read through the ticket's waitlist place. A place
+    // that reads 0 belongs to a booking being promoted or cancelled right now,
+    // so the ticket is looked up again once that change is published.
+    StatusResult findTicketStatus(const std::string& bookingId) {
+        StatusResult result;
+        try {
+            Ticket ticket = bookings.find(bookingId);
+            while (ticket.isWaitlisted() && ticket.hasWaitlistPlace()) {
+                result.waitlistPosition = ticket.getCurrentWaitlistPosition();
+                if (result.waitlistPosition > 0) {
+                    break;
+                }
+                std::this_thread::yield();
+                ticket = bookings.find(bookingId);
+            }
+            result.found = true;
+            result.ticket = std::make_shared<const Ticket>(ticket);
+        } catch (const TicketNotFoundException& e) {
+            result.error = std::string("Error: ") + e.what();
+        } catch (const TrainNotFoundException& e) {
+            result.error = std::string("Error: ") + e.what();
+        }
+        return result;
+    }
+    
+    // Drops the seat maps and tickets of every journey before the given date.
+    // Seat maps go as one range erase; tickets need a pass over the bookings.
+    void retireJourneysBefore(int journeyDate) {
+        std::vector<std::unique_lock<TrainLock> > trainGuards;
+        for (auto& lock : trainLocks) {
+            trainGuards.push_back(std::unique_lock<TrainLock>(*lock));
+        }
+        
+        size_t retiredJourneys;
+        {
+            std::lock_guard<std::mutex> journeysGuard(journeysMutex);
+            auto end = journeys.lower_bound(JourneyKey(journeyDate, 0));
+            retiredJourneys = std::distance(journeys.begin(), end);
+            journeys.erase(journeys.begin(), end);
+            publishJourneyIndex();
+            waitlists.erase(waitlists.begin(), waitlists.lower_bound(JourneyKey(journeyDate, 0)));
+        }
+        size_t retiredTickets = bookings.eraseBefore(journeyDate);
+        
+        if (retiredJourneys > 0 || retiredTickets > 0) {
+            std::cout << "Retired " << retiredJourneys << " past journey(s) and " << retiredTickets
+                      << " ticket(s) before " << formatDate(journeyDate) << std::endl;
+        }
+    }
+    
+    void loadTrainsFromCSV(const std::string& filename) {
+        CsvReader reader(filename);
+        
+        // Clear existing trains and their journeys
+        std::unique_ptr<std::vector<Train> > trains(new std::vector<Train>());
+        journeys.clear();
+        publishJourneyIndex();
+        waitlists.clear();
+        
+        std::string_view line;
+        // Skip header line
+        reader.nextLine(line);
+        
+        while (reader.nextLine(line)) {
+            std::string error = addTrainRow(line, *trains);
+            if (!error.empty()) {
+                std::cerr << "Error parsing CSV line: " << error << std::endl;
+                std::cerr << "Line content: " << line << std::endl;
+                // Continue to next line
+            }
+        }
+        
+        size_t loadedTrains = trains->size();
+        publishCatalog(std::move(trains));
+        std::cout << "Loaded " << loadedTrains << " trains from " << filename << std::endl;
+    }
+    
+    void saveTrainsToCSV(const std::string& filename) {
+        size_t savedTrains = writeTrainsCSV(filename);
+        std::cout << "Saved " << savedTrains << " trains to " << filename << std::endl;
+    }
+    
+    // Loads tickets on one thread per core, or on the given number. The file
+    // is cut at line boundaries into a piece per thread and the pieces are
+    // parsed side by side. Each row then goes to the thread that owns its
+    // train, which books the seats of that train alone and in file order, so
+    // no seat map is shared and a seat booked twice fails on the same row as
+    // in a one-thread load. A booking ID that appears more than once is
+    // settled by the booking table, first loaded row wins, as in a one-thread
+    // load; so that every row with the ID reaches the same thread in file
+    // order, the trains its rows name are owned together. Errors are
+    // gathered and reported in file order at the end.
+    void loadTicketsFromCSV(const std::string& filename, size_t threads = 0) {
+        CsvReader reader(filename);
+        
+        // Clear existing bookings
+        bookings.clear();
+        
+        std::string_view line;
+        // Skip header line; older files lack some columns
+        reader.nextLine(line);
+        TicketColumns columns = ticketColumns(line);
+        
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        // Small files are not worth the threads
+        threads = std::max<size_t>(1, std::min(threads, reader.remainingSize() / MIN_LOAD_PIECE_BYTES));
+        std::vector<std::string_view> pieces = reader.split(threads);
+        
+        // Per piece, its good rows and the IDs each thread checks
+        std::vector<std::vector<LoadedRow> > rowsByPiece(pieces.size());
+        std::vector<std::vector<std::vector<LoadedId> > > idsByChecker(
+            pieces.size(), std::vector<std::vector<LoadedId> >(threads));
+        std::vector<std::vector<TicketLoadError> > errors(threads);
+        runInParallel(pieces.size(), [&](size_t piece) {
+            CsvLines lines(pieces[piece]);
+            std::string_view row;
+            while (lines.nextLine(row)) {
+                TicketRow parsed;
+                std::string error = parseTicketRow(row, columns, parsed);
+                if (!error.empty()) {
+                    errors[piece].push_back(TicketLoadError{row.data(), "Error parsing CSV line: " + error, row});
+                    continue;
+                }
+                rowsByPiece[piece].push_back(LoadedRow{row, parsed.trainId});
+                if (threads == 1) {
+                    continue; // one thread owns every train
+                }
+                size_t hash = std::hash<std::string_view>()(parsed.bookingId);
+                idsByChecker[piece][hash % threads].push_back(LoadedId{hash, parsed.bookingId, parsed.trainId});
+            }
+        });
+        
+        // Pairs of trains that share a booking ID
+        std::vector<std::vector<std::pair<int, int> > > sharedIds(threads);
+        runInParallel(threads, [&](size_t checker) {
+            std::vector<LoadedId> ids;
+            for (auto& piece : idsByChecker) {
+                ids.insert(ids.end(), piece[checker].begin(), piece[checker].end());
+                std::vector<LoadedId>().swap(piece[checker]);
+            }
+            std::sort(ids.begin(), ids.end(), [](const LoadedId& a, const LoadedId& b) {
+                return a.hash < b.hash;
+            });
+            for (size_t first = 0, next; first < ids.size(); first = next) {
+                for (next = first + 1; next < ids.size() && ids[next].hash == ids[first].hash; next++) {
+                    for (size_t earlier = first; earlier < next; earlier++) {
+                        if (ids[earlier].bookingId == ids[next].bookingId) {
+                            if (ids[earlier].trainId != ids[next].trainId) {
+                                sharedIds[checker].push_back(std::make_pair(ids[earlier].trainId, ids[next].trainId));
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+        });
+        TrainGroups groups;
+        for (const auto& found : sharedIds) {
+            for (const auto& pair : found) {
+                groups.join(pair.first, pair.second);
+            }
+        }
+        
+        // Per piece, the rows each thread owns, still in file order
+        std::vector<std::vector<std::vector<std::string_view> > > rowsByOwner(
+            pieces.size(), std::vector<std::vector<std::string_view> >(threads));
+        runInParallel(pieces.size(), [&](size_t piece) {
+            for (const LoadedRow& row : rowsByPiece[piece]) {
+                rowsByOwner[piece][static_cast<unsigned>(groups.root(row.trainId)) % threads].push_back(row.line);
+            }
+            std::vector<LoadedRow>().swap(rowsByPiece[piece]);
+        });
+        
+        // Waitlisted tickets are queued after the whole file is read, in
+        // the order of their saved positions
+        std::vector<LoadedWaitlist> waitlisted(threads);
+        std::vector<int> loaded(threads, 0);
+        runInParallel(threads, [&](size_t owner) {
+            std::map<JourneyKey, Train*> journeysUsed;
+            for (const auto& piece : rowsByOwner) {
+                for (std::string_view row : piece[owner]) {
+                    TicketRow parsed;
+                    parseTicketRow(row, columns, parsed);
+                    std::string error = applyTicketRow(parsed, journeysUsed, waitlisted[owner]);
+                    if (error.empty()) {
+                        loaded[owner]++;
+                    } else {
+                        errors[owner].push_back(TicketLoadError{row.data(), error, row});
+                    }
+                }
+            }
+        });
+        // Journeys made while loading were not published one by one
+        publishJourneyIndex();
+        
+        std::vector<TicketLoadError> allErrors;
+        for (auto& found : errors) {
+            std::move(found.begin(), found.end(), std::back_inserter(allErrors));
+        }
+        std::sort(allErrors.begin(), allErrors.end(), [](const TicketLoadError& a, const TicketLoadError& b) {
+            return a.position < b.position;
+        });
+        for (const auto& error : allErrors) {
+            std::cerr << error.message << std::endl;
+            std::cerr << "Line content: " << error.line << std::endl;
+        }
+        
+        LoadedWaitlist allWaitlisted;
+        for (auto& found : waitlisted) {
+            allWaitlisted.insert(allWaitlisted.end(), found.begin(), found.end());
+        }
+        std::sort(allWaitlisted.begin(), allWaitlisted.end());
+        for (const auto& entry : allWaitlisted) {
+            enqueueWaitlisted(entry.first.first, entry.second);
+        }
+        
+        int loadedTickets = 0;
+        for (int count : loaded) {
+            loadedTickets += count;
+        }
+        std::cout << "Loaded " << loadedTickets << " tickets from " << filename << std::endl;
+        if (!allErrors.empty()) {
+            std::cout << "Warning: " << allErrors.size() << " tickets could not be loaded due to errors." << std::endl;
+        }
+    }
+    
+    void saveTicketsToCSV(const std::string& filename) {
+        BookingTable::Pin pin(bookings);
+        std::vector<const Ticket*> tickets;
+        std::unordered_map<std::string, int> waitlistPositions;
+        {
+            CheckpointGate::Closed closed(changeGate);
+            captureTickets(pin, tickets, waitlistPositions);
+        }
+        size_t savedTickets = writeTicketsCSV(filename, tickets, waitlistPositions);
+        std::cout << "Saved " << savedTickets << " tickets to " << filename << std::endl;
+    }
+    
+    // Replays the booking changes in a write-ahead log on top of the loaded
+    // tickets, then appends every later change to it. Call after loading the
+    // snapshot or CSV files, before any other call. A booking or cancel returns once its
+    // record is synced; concurrent ones share a sync, and durabilityWindow
+    // bounds how long the first waits for others to join it.
+    void openWriteAheadLog(const std::string& filename,
+                           std::chrono::microseconds durabilityWindow =
+                               std::chrono::microseconds(WriteAheadLog::DEFAULT_WINDOW_MICROS)) {
+        wal.reset();
+        size_t replayed = WriteAheadLog::replay(filename, [this](const LogRecord& record) {
+            applyLogRecord(record);
+        });
+        wal.reset(new WriteAheadLog(filename, durabilityWindow));
+        if (replayed > 0) {
+            std::cout << "Replayed " << replayed << " booking change(s) from " << filename << std::endl;
+        }
+    }
+    
+    // Saves the trains, their journeys' seat maps and the tickets as of one
+    // instant to a binary snapshot, then drops the log segments it covers, so
+    // startup loads the snapshot and replays only changes made since. Changes
+    // pause only while the log moves to a new segment and the tickets are
+    // gathered; the snapshot is written once they resume, to a temporary file
+    // renamed into place. Returns false, writing nothing, if the log has had
+    // no changes since the last checkpoint.
+    bool checkpoint(const std::string& snapshotFile) {
+        std::lock_guard<std::mutex> checkpointGuard(checkpointMutex);
+        if (wal && !wal->hasUncheckpointedRecords()) {
+            return false;
+        }
+        
+        BookingTable::Pin pin(bookings);
+        std::vector<const Ticket*> tickets;
+        std::unordered_map<std::string, int> waitlistPositions;
+        uint64_t firstUncovered = 0;
+        {
+            CheckpointGate::Closed closed(changeGate);
+            if (wal) {
+                firstUncovered = wal->startSegment();
+            }
+            captureTickets(pin, tickets, waitlistPositions);
+        }
+        
+        writeSnapshot(snapshotFile + ".tmp", tickets, waitlistPositions);
+        WriteAheadLog::replaceDurably(snapshotFile + ".tmp", snapshotFile);
+        if (wal) {
+            wal->dropSegmentsBefore(firstUncovered);
+        }
+        return true;
+    }
+    
+    // Replaces the trains, journeys and tickets with those of a snapshot
+    // written by checkpoint. The header, checksum and seat map sizes are
+    // checked before anything changes. Seat maps are copied in as saved
+    // rather than rebuilt by rebooking every ticket.
+    void loadSnapshot(const std::string& filename) {
+        SnapshotReader snapshot(filename);
+        
+        std::unique_ptr<std::vector<Train> > trains(new std::vector<Train>());
+        std::map<JourneyKey, Train> restored;
+        try {
+            for (size_t i = 0; i < snapshot.trainCount(); i++) {
+                const SnapshotTrain& record = snapshot.train(i);
+                trains->push_back(Train(record.trainId, snapshot.text(record.name), record.totalSeats,
+                                        record.berthsPerCoach, snapshot.route(record),
+                                        record.lockFree ? SeatMapMode::LockFree : SeatMapMode::Locked));
+            }
+            for (size_t i = 0; i < snapshot.journeyCount(); i++) {
+                const SnapshotJourney& record = snapshot.journey(i);
+                Train& journey = restored.emplace_hint(restored.end(), JourneyKey(record.journeyDate, record.trainId),
+                                                       findTrain(*trains, record.trainId))->second;
+                journey.importSeatWords(snapshot.seatWords(record, journey.seatMapWordCount()));
+            }
+        } catch (const InvalidInputException& e) {
+            throw SnapshotFormatException(filename, e.what());
+        } catch (const TrainNotFoundException& e) {
+            throw SnapshotFormatException(filename, e.what());
+        }
+        
+        size_t loadedTrains = trains->size();
+        publishCatalog(std::move(trains));
+        journeys.swap(restored);
+        publishJourneyIndex();
+        waitlists.clear();
+        bookings.clear();
+        
+        int loadedTickets = 0;
+        int errorCount = 0;
+        LoadedWaitlist waitlisted;
+        for (size_t i = 0; i < snapshot.ticketCount(); i++) {
+            const SnapshotTicket& record = snapshot.ticket(i);
+            try {
+                std::string bookingId = snapshot.text(record.bookingId);
+                BookingIdGenerator::reserveIssued(bookingId);
+                bookings.insert(Ticket(bookingId, record.trainId, record.seatNumber,
+                                       snapshot.text(record.passengerName), snapshot.text(record.boardingStop),
+                                       snapshot.text(record.alightingStop), record.journeyDate,
+                                       record.waitlistNumber, snapshot.text(record.bookingTime)));
+                if (record.waitlistPosition > 0) {
+                    waitlisted.push_back(std::make_pair(std::make_pair(
+                        JourneyKey(record.journeyDate, record.trainId), record.waitlistPosition), bookingId));
+                }
+                loadedTickets++;
+            } catch (const InvalidInputException& e) {
+                std::cerr << "Error restoring ticket from snapshot: " << e.what() << std::endl;
+                errorCount++;
+            } catch (const SnapshotFormatException& e) {
+                std::cerr << "Error restoring ticket from snapshot: " << e.what() << std::endl;
+                errorCount++;
+            }
+        }
+        
+        std::sort(waitlisted.begin(), waitlisted.end());
+        for (const auto& entry : waitlisted) {
+            enqueueWaitlisted(entry.first.first, entry.second);
+        }
+        
+        std::cout << "Loaded " << loadedTrains << " trains, " << journeys.size() << " journeys and "
+                  << loadedTickets << " tickets from " << filename << std::endl;
+        if (errorCount > 0) {
+            std::cout << "Warning: " << errorCount << " tickets could not be loaded due to errors." << std::endl;
+        }
+    }
+    
+    // Number of syncs the write-ahead log has made; each covers every change
+    // committed while it was pending
+    size_t writeAheadLogSyncs() const {
+        return wal ? wal->syncCount() : 0;
+    }
+    
+private:
+    // Gathers every ticket and the waitlist position of each waitlisted one;
+    // the caller holds the change gate closed, and the records stay valid
+    // while the pin lives
+    void captureTickets(const BookingTable::Pin& pin, std::vector<const Ticket*>& tickets,
+                        std::unordered_map<std::string, int>& waitlistPositions) {
+        tickets = bookings.records(pin);
+        std::lock_guard<std::mutex> journeysGuard(journeysMutex);
+        for (const auto& entry : waitlists) {
+            entry.second.forEachWaiting([&](const std::string& bookingId, int position) {
+                waitlistPositions[bookingId] = position;
+            });
+        }
+    }
+    
+    // Parses one trains.csv line and appends its train; returns what is wrong
+    // with the line, or an empty string. Throws nothing.
+    static std::string addTrainRow(std::string_view line, std::vector<Train>& trains) {
+        CsvFields fields(line);
+        std::string_view field;
+        int trainId;
+        std::string_view trainName;
+        int totalSeats;
+        int availableSeats;
+        
+        if (!fields.next(field)) return "missing train ID";
+        if (!parseIntField(field, trainId)) return "train ID is not a valid number: " + std::string(field);
+        if (!fields.next(trainName)) return "missing train name";
+        if (!fields.next(field)) return "missing total seats";
+        if (!parseIntField(field, totalSeats)) return "total seats is not a valid number: " + std::string(field);
+        if (!fields.next(field)) return "missing available seats";
+        if (!parseIntField(field, availableSeats)) {
+            return "available seats is not a valid number: " + std::string(field);
+        }
+        
+        // berthsPerCoach, stops ('|' separated) and seatMapMode are optional;
+        // older files do not have them
+        int berthsPerCoach = SeatLayout::DEFAULT_BERTHS_PER_COACH;
+        if (fields.next(field) && !field.empty() && !parseIntField(field, berthsPerCoach)) {
+            return "berths per coach is not a valid number: " + std::string(field);
+        }
+        
+        std::vector<std::string> stops;
+        if (fields.next(field) && !field.empty()) {
+            for (size_t start = 0; start <= field.size(); ) {
+                size_t bar = std::min(field.find('|', start), field.size());
+                stops.emplace_back(field.substr(start, bar - start));
+                start = bar + 1;
+            }
+        }
+        
+        SeatMapMode mode = SeatMapMode::Locked;
+        if (fields.next(field) && !field.empty()) {
+            if (field == "lockfree") {
+                mode = SeatMapMode::LockFree;
+            } else if (field != "locked") {
+                return "unknown seat map mode: " + std::string(field);
+            }
+        }
+        
+        // Seat occupancy is rebuilt from tickets.csv, which records the
+        // legs each seat is booked for; availableSeats is only checked
+        if (availableSeats < 0 || availableSeats > totalSeats) {
+            return "available seats is out of range: " + std::to_string(availableSeats);
+        }
+        
+        try {
+            trains.push_back(Train(trainId, std::string(trainName), totalSeats, berthsPerCoach, stops, mode));
+        } catch (const InvalidInputException& e) {
+            return e.what();
+        }
+        return std::string();
+    }
+    
+    // Columns of a tickets.csv file; files written before segment booking,
+    // journey dates or waitlists lack some
+    struct TicketColumns {
+        bool hasStops;
+        bool hasDate;
+        bool hasWaitlist;
+        int defaultDate; // journey date of rows in files without one
+    };
+    
+    // One tickets.csv row; its text fields view the line it was parsed from
+    struct TicketRow {
+        std::string_view bookingId;
+        int trainId;
+        int seatNumber;
+        std::string_view passengerName;
+        std::string_view boardingStop;  // empty, with alightingStop, for the whole route
+        std::string_view alightingStop;
+        int journeyDate;
+        int waitlistNumber;
+        int waitlistPosition;
+        std::string_view bookingTime;
+    };
+    
+    // Waiting tickets met while loading, keyed by journey and saved position
+    typedef std::vector<std::pair<std::pair<JourneyKey, int>, std::string> > LoadedWaitlist;
+    
+    // A booking ID met while loading tickets, with its hash and its row's train
+    struct LoadedId {
+        size_t hash;
+        std::string_view bookingId;
+        int trainId;
+    };
+    
+    // A parsed tickets.csv row waiting to be routed to its owner
+    struct LoadedRow {
+        std::string_view line;
+        int trainId;
+    };
+    
+    // Trains whose rows must be applied by one thread, because a booking ID
+    // appears on rows of more than one of them; a union-find keyed by train ID
+    class TrainGroups {
+    private:
+        std::unordered_map<int, int> parent;
+        
+    public:
+        int find(int trainId) {
+            auto it = parent.find(trainId);
+            if (it == parent.end()) {
+                return trainId;
+            }
+            if (it->second != trainId) {
+                it->second = find(it->second);
+            }
+            return it->second;
+        }
+        
+        void join(int a, int b) {
+            parent.emplace(a, a);
+            parent.emplace(b, b);
+            int rootA = find(a);
+            int rootB = find(b);
+            if (rootA != rootB) {
+                parent[std::max(rootA, rootB)] = std::min(rootA, rootB);
+            }
+        }
+        
+        // Group of a train, read-only once every join is done
+        int root(int trainId) const {
+            auto it = parent.find(trainId);
+            while (it != parent.end() && it->second != it->first) {
+                it = parent.find(it->second);
+            }
+            return it == parent.end() ? trainId : it->first;
+        }
+    };
+    
+    // A tickets.csv row that could not be loaded; position is where its line
+    // starts in the mapped file, so sorting by it restores file order
+    struct TicketLoadError {
+        const char* position;
+        std::string message;
+        std::string_view line;
+    };
+    
+    // Least share of a tickets.csv file worth a loader thread of its own
+    static const size_t MIN_LOAD_PIECE_BYTES = 1 << 20;
+    
+    // Runs work(0) to work(count - 1) side by side, work(0) on the calling thread
+    template <typename Work>
+    static void runInParallel(size_t count, Work work) {
+        std::vector<std::thread> helpers;
+        for (size_t i = 1; i < count; i++) {
+            helpers.emplace_back(work, i);
+        }
+        if (count > 0) {
+            work(0);
+        }
+        for (auto& helper : helpers) {
+            helper.join();
+        }
+    }
+    
+    static TicketColumns ticketColumns(std::string_view header) {
+        TicketColumns columns;
+        columns.hasStops = header.find("boardingStop") != std::string_view::npos;
+        columns.hasDate = header.find("journeyDate") != std::string_view::npos;
+        columns.hasWaitlist = header.find("waitlistPosition") != std::string_view::npos;
+        columns.defaultDate = todayDate();
+        return columns;
+    }
+    
+    // Splits and checks one tickets.csv line; returns what is wrong with it,
+    // or an empty string once row is filled in. Throws nothing.
+    static std::string parseTicketRow(std::string_view line, const TicketColumns& columns, TicketRow& row) {
+        CsvFields fields(line);
+        std::string_view field;
+        
+        if (!fields.next(row.bookingId)) return "missing booking ID";
+        if (!fields.next(field)) return "missing train ID";
+        if (!parseIntField(field, row.trainId)) return "train ID is not a valid number: " + std::string(field);
+        if (!fields.next(field)) return "missing seat number";
+        if (!parseIntField(field, row.seatNumber)) return "seat number is not a valid number: " + std::string(field);
+        if (!fields.next(row.passengerName)) return "missing passenger name";
+        
+        row.boardingStop = std::string_view();
+        row.alightingStop = std::string_view();
+        if (columns.hasStops) {
+            if (!fields.next(row.boardingStop)) return "missing boarding stop";
+            if (!fields.next(row.alightingStop)) return "missing alighting stop";
+        }
+        
+        row.journeyDate = columns.defaultDate;
+        if (columns.hasDate) {
+            if (!fields.next(field)) return "missing journey date";
+            switch (parseDateField(field, row.journeyDate)) {
+                case DateParse::BadFormat:  return "date must be in YYYY-MM-DD format: " + std::string(field);
+                case DateParse::NoSuchDate: return "no such date: " + std::string(field);
+                case DateParse::Ok:         break;
+            }
+        }
+        
+        row.waitlistNumber = 0;
+        row.waitlistPosition = 0;
+        if (columns.hasWaitlist) {
+            if (!fields.next(field)) return "missing waitlist number";
+            if (!parseIntField(field, row.waitlistNumber)) {
+                return "waitlist number is not a valid number: " + std::string(field);
+            }
+            if (!fields.next(field)) return "missing waitlist position";
+            if (!parseIntField(field, row.waitlistPosition)) {
+                return "waitlist position is not a valid number: " + std::string(field);
+            }
+        }
+        
+        // The booking time is the rest of the line
+        row.bookingTime = fields.remainder();
+        return std::string();
+    }
+    
+    // Books a parsed row's seat on its journey and stores its ticket, or
+    // stores a waiting ticket and queues it for the journey's waitlist.
+    // Returns what went wrong, or an empty string. Loader threads call it
+    // at once for rows of different trains; journeysUsed is the caller's.
+    std::string applyTicketRow(const TicketRow& row, std::map<JourneyKey, Train*>& journeysUsed,
+                               LoadedWaitlist& waitlisted) {
+        BookingIdGenerator::reserveIssued(row.bookingId);
+        Train* journey;
+        try {
+            journey = &loadingJourneyRef(row.trainId, row.journeyDate, journeysUsed);
+        } catch (const TrainNotFoundException& e) {
+            return std::string("Error finding train from CSV: ") + e.what();
+        }
+        Train& train = *journey;
+        
+        // A ticket still waiting for a cancellation has no seat
+        bool waiting = row.waitlistPosition > 0;
+        bool wholeRoute = row.boardingStop.empty() && row.alightingStop.empty();
+        std::optional<Ticket> ticket;
+        try {
+            std::string bookingId(row.bookingId);
+            std::string boarding = wholeRoute ? train.getStops().front() : std::string(row.boardingStop);
+            std::string alighting = wholeRoute ? train.getStops().back() : std::string(row.alightingStop);
+            if (row.bookingTime.empty()) {
+                ticket.emplace(bookingId, row.trainId, waiting ? 0 : row.seatNumber, std::string(row.passengerName),
+                               boarding, alighting, row.journeyDate, row.waitlistNumber);
+            } else {
+                ticket.emplace(bookingId, row.trainId, waiting ? 0 : row.seatNumber, std::string(row.passengerName),
+                               boarding, alighting, row.journeyDate, row.waitlistNumber, std::string(row.bookingTime));
+            }
+        } catch (const InvalidInputException& e) {
+            return std::string("Error creating ticket from CSV: ") + e.what();
+        }
+        
+        try {
+            int fromStop = train.getStopIndex(ticket->getBoardingStop());
+            int toStop = train.getStopIndex(ticket->getAlightingStop());
+            if (!waiting && !train.bookSpecificSeat(row.seatNumber, fromStop, toStop)) {
+                return "Warning: Seat " + std::to_string(row.seatNumber) + " on train " + std::to_string(row.trainId) +
+                       " is already booked. Skipping ticket: " + std::string(row.bookingId);
+            }
+            if (!bookings.insert(std::move(*ticket))) {
+                if (!waiting) {
+                    train.cancelSeat(row.seatNumber, fromStop, toStop);
+                }
+                return "Warning: Booking ID " + std::string(row.bookingId) + " appears twice. Skipping the later ticket.";
+            }
+        } catch (const SeatNotFoundException& e) {
+            return std::string("Error booking seat from CSV: ") + e.what();
+        } catch (const StopNotFoundException& e) {
+            return std::string("Error booking seat from CSV: ") + e.what();
+        } catch (const InvalidInputException& e) {
+            return std::string("Error booking seat from CSV: ") + e.what();
+        }
+        
+        if (waiting) {
+            waitlisted.push_back(std::make_pair(std::make_pair(JourneyKey(row.journeyDate, row.trainId),
+                                                               row.waitlistPosition), std::string(row.bookingId)));
+        }
+        return std::string();
+    }
+    
+    // Writes the catalog, the captured tickets and the seat maps of their
+    // journeys. The seat maps are rebuilt from the tickets rather than copied:
+    // seats are claimed outside the change gate, so the live maps may be a
+    // moment ahead of the captured tickets. Held seats are not saved and go
+    // back on sale, as with the CSV files.
+    void writeSnapshot(const std::string& filename, const std::vector<const Ticket*>& tickets,
+                       const std::unordered_map<std::string, int>& waitlistPositions) {
+        SnapshotWriter snapshot;
+        TrainCatalog::ReadGuard trains(catalog);
+        for (const auto& train : *trains) {
+            snapshot.addTrain(train);
+        }
+        
+        std::map<JourneyKey, Train> seatMaps;
+        for (const Ticket* ticket : tickets) {
+            auto position = waitlistPositions.find(ticket->getBookingId());
+            snapshot.addTicket(*ticket, position == waitlistPositions.end() ? 0 : position->second);
+            
+            JourneyKey key(ticket->getJourneyDate(), ticket->getTrainId());
+            auto journey = seatMaps.find(key);
+            try {
+                if (journey == seatMaps.end()) {
+                    journey = seatMaps.emplace(key, findTrain(*trains, ticket->getTrainId())).first;
+                }
+                if (!ticket->isWaitlisted()) {
+                    Train& seatMap = journey->second;
+                    seatMap.bookSpecificSeat(ticket->getSeatNumber(), seatMap.getStopIndex(ticket->getBoardingStop()),
+                                             seatMap.getStopIndex(ticket->getAlightingStop()));
+                }
+            } catch (const std::runtime_error&) {
+                // The ticket is saved, but a train, stop or seat the catalog
+                // no longer has cannot be marked booked
+            }
+        }
+        for (const auto& journey : seatMaps) {
+            snapshot.addJourney(journey.first.first, journey.second);
+        }
+        snapshot.write(filename);
+    }
+    
+    size_t writeTrainsCSV(const std::string& filename) {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            throw FileIOException(filename, "open for writing");
+        }
+        
+        // Write header
+        file << "trainId,trainName,totalSeats,availableSeats,berthsPerCoach,stops,seatMapMode\n";
+        
+        // Write train data
+        TrainCatalog::ReadGuard trains(catalog);
+        PublishedJourneyIndex::ReadGuard index(journeyIndex);
+        for (const auto& train : *trains) {
+            file << train.getTrainId() << ","
+                 << train.getTrainName() << ","
+                 << train.getTotalSeats() << ","
+                 << findJourney(*trains, *index, train.getTrainId(), todayDate()).getAvailableSeatsCount() << ","
+                 << train.getLayout().getBerthsPerCoach() << ","
+                 << joinStops(train.getStops(), "|") << ","
+                 << (train.isLockFree() ? "lockfree" : "locked") << "\n";
+        }
+        
+        if (file.fail()) {
+            throw FileIOException(filename, "write to");
+        }
+        return trains->size();
+    }
+    
+    size_t writeTicketsCSV(const std::string& filename, const std::vector<const Ticket*>& tickets,
+                           const std::unordered_map<std::string, int>& waitlistPositions) {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            throw FileIOException(filename, "open for writing");
+        }
+        
+        // Write header
+        file << "bookingId,trainId,seatNumber,passengerName,boardingStop,alightingStop,journeyDate,"
+             << "waitlistNumber,waitlistPosition,bookingTime\n";
+        
+        // Write ticket data
+        for (const Ticket* ticket : tickets) {
+            auto position = waitlistPositions.find(ticket->getBookingId());
+            file << ticket->getBookingId() << ","
+                 << ticket->getTrainId() << ","
+                 << ticket->getSeatNumber() << ","
+                 << ticket->getPassengerName() << ","
+                 << ticket->getBoardingStop() << ","
+                 << ticket->getAlightingStop() << ","
+                 << formatDate(ticket->getJourneyDate()) << ","
+                 << ticket->getWaitlistNumber() << ","
+                 << (position == waitlistPositions.end() ? 0 : position->second) << ","
+                 << ticket->getBookingTime() << "\n";
+        }
+        
+        if (file.fail()) {
+            throw FileIOException(filename, "write to");
+        }
+        return tickets.size();
+    }
+    
+    static std::string joinStops(const std::vector<std::string>& stops, const std::string& separator) {
+        std::string joined;
+        for (size_t i = 0; i < stops.size(); i++) {
+            if (i > 0) joined += separator;
+            joined += stops[i];
+        }
+        return joined;
+    }
+    
+    // Swaps in a new catalog and gives each of its trains a fresh, unlocked lock
+    void publishCatalog(std::unique_ptr<std::vector<Train> > trains) {
+        trainLocks.clear();
+        trainLocksById.clear();
+        for (size_t i = 0; i < trains->size(); i++) {
+            trainLocks.push_back(std::unique_ptr<TrainLock>(new TrainLock()));
+            trainLocksById.emplace((*trains)[i].getTrainId(), trainLocks.back().get());
+        }
+        catalog.publish(std::unique_ptr<const std::vector<Train> >(std::move(trains)));
+    }
+    
+    // Helper method to find the lock guarding a train's journeys
+    TrainLock& trainLock(int trainId) const {
+        auto it = trainLocksById.find(trainId);
+        if (it == trainLocksById.end()) {
+            throw TrainNotFoundException(trainId);
+        }
+        return *it->second;
+    }
+    
+    // Helper method to find a train by ID in a catalog snapshot
+    static const Train& findTrain(const std::vector<Train>& trains, int trainId) {
+        for (const auto& train : trains) {
+            if (train.getTrainId() == trainId) {
+                return train;
+            }
+        }
+        throw TrainNotFoundException(trainId);
+    }
+    
+    // Helper method to find a train's seat map for a date, creating it on first use.
+    // The caller holds the train's lock; map nodes stay put when others are added.
+    Train& findJourneyRef(int trainId, int journeyDate) {
+        Train* journey = lookupJourney(trainId, journeyDate);
+        if (journey != nullptr) {
+            return *journey;
+        }
+        std::lock_guard<std::mutex> journeysGuard(journeysMutex);
+        auto it = journeys.find(JourneyKey(journeyDate, trainId));
+        if (it != journeys.end()) {
+            return it->second;
+        }
+        TrainCatalog::ReadGuard trains(catalog);
+        Train& created = journeys.emplace(JourneyKey(journeyDate, trainId), findTrain(*trains, trainId)).first->second;
+        publishJourneyIndex();
+        return created;
+    }
+    
+    // Like findJourneyRef, for loader threads: each remembers the journeys
+    // it has used, so journeysMutex is only taken to find or make a new one.
+    // The caller publishes the journey index once loading is done.
+    Train& loadingJourneyRef(int trainId, int journeyDate, std::map<JourneyKey, Train*>& journeysUsed) {
+        JourneyKey key(journeyDate, trainId);
+        auto used = journeysUsed.find(key);
+        if (used != journeysUsed.end()) {
+            return *used->second;
+        }
+        std::lock_guard<std::mutex> journeysGuard(journeysMutex);
+        auto it = journeys.find(key);
+        if (it == journeys.end()) {
+            TrainCatalog::ReadGuard trains(catalog);
+            it = journeys.emplace(key, findTrain(*trains, trainId)).first;
+        }
+        journeysUsed.emplace(key, &it->second);
+        return it->second;
+    }
+    
+    // Seat map of an existing journey from the published index, or null.
+    // Takes no lock; journeys are only erased while no other call runs, so
+    // the pointer outlives the epoch pin.
+    Train* lookupJourney(int trainId, int journeyDate) const {
+        PublishedJourneyIndex::ReadGuard index(journeyIndex);
+        return lookupJourney(*index, trainId, journeyDate);
+    }
+    
+    static Train* lookupJourney(const JourneyIndex& index, int trainId, int journeyDate) {
+        auto it = index.find(JourneyKey(journeyDate, trainId));
+        return it == index.end() ? nullptr : it->second;
+    }
+    
+    // Republishes journeyIndex from journeys; the caller holds journeysMutex
+    // or runs alone
+    void publishJourneyIndex() {
+        std::unique_ptr<JourneyIndex> index(new JourneyIndex());
+        for (auto& journey : journeys) {
+            index->emplace_hint(index->end(), journey.first, &journey.second);
+        }
+        journeyIndex.publish(std::unique_ptr<const JourneyIndex>(std::move(index)));
+    }
+    
+    // Helper method to find a train's seat map for a date without creating one;
+    // a date with no bookings is answered by the all-free train of the catalog
+    // snapshot, which the caller keeps pinned while it uses the result.
+    // Takes no lock; seat counts are then read through Train::getSeatCounts.
+    static const Train& findJourney(const std::vector<Train>& trains, const JourneyIndex& index,
+                                    int trainId, int journeyDate) {
+        const Train* journey = lookupJourney(index, trainId, journeyDate);
+        return journey != nullptr ? *journey : findTrain(trains, trainId);
+    }
+    
+    // Helper method to find a journey's waitlist, creating it on first use;
+    // the caller holds the train's lock
+    Waitlist& findWaitlistRef(const JourneyKey& key) {
+        std::lock_guard<std::mutex> journeysGuard(journeysMutex);
+        return waitlists[key];
+    }
+    
+    // Adds a stored waitlisted ticket to its journey's waitlist and gives the
+    // ticket its place; used while loading, before requests are served
+    void enqueueWaitlisted(const JourneyKey& key, const std::string& bookingId) {
+        bookings.setWaitlistPlace(bookingId, findWaitlistRef(key).join(bookingId));
+    }
+    
+    // Runs a seat claim for a single booking and returns the seat number, or
+    // -1 when the journey is full and the caller should waitlist; the train
+    // lock is held in that case. Locked trains claim under the train lock.
+    // Lock-free trains claim without it and take it only once the train looks
+    // full, claiming once more so a seat freed by a cancel that finished just
+    // before is not missed. Their journeys are safe to use unlocked because
+    // only past dates, which cannot be booked, are ever retired.
+    template <typename Claim>
+    static int claimSeat(const Train& train, std::unique_lock<TrainLock>& trainGuard, Claim claim) {
+        if (!train.isLockFree()) {
+            trainGuard.lock();
+        }
+        try {
+            return claim();
+        } catch (const NoSeatsAvailableException&) {
+            if (trainGuard.owns_lock()) {
+                return -1;
+            }
+        }
+        
+        trainGuard.lock();
+        try {
+            return claim();
+        } catch (const NoSeatsAvailableException&) {
+            return -1;
+        }
+    }
+    
+    // Removes a live hold so that only one caller can confirm or release it
+    bool takeHold(const std::string& holdId, SeatHold& hold) {
+        std::lock_guard<std::mutex> holdsGuard(holdsMutex);
+        auto it = holds.find(holdId);
+        if (it == holds.end()) {
+            return false;
+        }
+        hold = it->second;
+        holds.erase(it);
+        return true;
+    }
+    
+    // Returns a held seat to sale, offering it to the waitlist first;
+    // the caller holds the train's lock
+    void releaseHeldSeat(const SeatHold& hold) {
+        Train& train = findJourneyRef(hold.trainId, hold.journeyDate);
+        JourneyKey key(hold.journeyDate, hold.trainId);
+        if (train.isLockFree()) {
+            Promotion promotion = Promotion();
+            {
+                CheckpointGate::Pass pass(changeGate);
+                promotion = handSeatToWaitlist(key, hold.seatNumber);
+            }
+            if (!promotion.bookingId.empty()) {
+                train.confirmHeldSeat(); // the seat stays taken, now by the promoted ticket
+                reportPromotion(promotion);
+                return;
+            }
+        }
+        if (train.releaseHeldSeat(hold.seatNumber)) {
+            reportPromotion(promoteFromWaitlist(train, key, hold.seatNumber));
+        }
+    }
+    
+    // The same as bookSeat without waiting for the log; the caller waits
+    // once the train lock is released
+    BookingResult bookSeatLogged(int trainId, int journeyDate, const std::string& passengerName,
+                           BerthPreference preference) {
+        BookingResult result;
+        if (passengerName.empty()) {
+            result.error = "Error: Passenger name cannot be empty.";
+            return result;
+        }
+        result.error = bookableDateError(journeyDate);
+        if (result.error.empty()) {
+            result.error = logFailureError();
+        }
+        if (!result.error.empty()) {
+            return result;
+        }
+        
+        try {
+            std::unique_lock<TrainLock> trainGuard(trainLock(trainId), std::defer_lock);
+            Train& train = findJourneyRef(trainId, journeyDate);
+            
+            int seatNumber = claimSeat(train, trainGuard, [&]() { return train.bookPreferredSeat(preference); });
+            if (seatNumber < 0) {
+                return joinWaitlist(trainId, journeyDate, passengerName,
+                                    train.getStops().front(), train.getStops().back());
+            }
+            try {
+                std::string bookingId = generateBookingId();
+                std::shared_ptr<const Ticket> ticket = std::make_shared<const Ticket>(
+                    bookingId, trainId, seatNumber, passengerName,
+                    train.getStops().front(), train.getStops().back(), journeyDate);
+                CheckpointGate::Pass pass(changeGate);
+                logTicketIssued(*ticket);
+                bookings.insert(*ticket);
+                
+                result.success = true;
+                result.bookingId = bookingId;
+                result.seatNumber = seatNumber;
+                result.preferenceMet = train.getLayout().matches(seatNumber, preference);
+                result.allocation = train.getLayout().describe(seatNumber);
+                result.ticket = ticket;
+                return result;
+            } catch (const std::runtime_error& e) {
+                // Undo seat booking if ticket creation fails
+                train.cancelSeat(seatNumber);
+                result.error = std::string("Error creating ticket: ") + e.what();
+                return result;
+            }
+        } catch (const TrainNotFoundException& e) {
+            result.error = std::string("Error: ") + e.what();
+            return result;
+        }
+    }
+    
+    // The same as cancelBooking without waiting for the log; the caller
+    // waits once the train lock is released
+    CancelResult cancelBookingLogged(const std::string& bookingId) {
+        CancelResult result;
+        result.error = logFailureError();
+        if (!result.error.empty()) {
+            return result;
+        }
+        try {
+            int trainId = bookings.find(bookingId).getTrainId();
+            std::lock_guard<TrainLock> trainGuard(trainLock(trainId));
+            // Read again under the train lock; a waitlisted ticket may have been promoted meanwhile
+            Ticket ticket = bookings.find(bookingId);
+            int seatNumber = ticket.getSeatNumber();
+            JourneyKey key(ticket.getJourneyDate(), trainId);
+            
+            if (ticket.isWaitlisted()) {
+                CheckpointGate::Pass pass(changeGate);
+                logTicketCancelled(bookingId);
+                findWaitlistRef(key).remove(bookingId);
+                bookings.erase(bookingId);
+                result.success = true;
+                result.wasWaitlisted = true;
+                return result;
+            }
+            
+            Train& train = findJourneyRef(trainId, ticket.getJourneyDate());
+            
+            try {
+                int fromStop = train.getStopIndex(ticket.getBoardingStop());
+                int toStop = train.getStopIndex(ticket.getAlightingStop());
+                bool cancelled;
+                {
+                    CheckpointGate::Pass pass(changeGate);
+                    // Logged before the seat is freed, so that a lock-free booking
+                    // that takes it is always logged after this cancel
+                    logTicketCancelled(bookingId);
+                    if (train.isLockFree()) {
+                        result.promotion = handSeatToWaitlist(key, seatNumber);
+                    }
+                    cancelled = !result.promotion.bookingId.empty() || train.cancelSeat(seatNumber, fromStop, toStop);
+                    if (cancelled) {
+                        bookings.erase(bookingId);
+                    }
+                }
+                if (cancelled) {
+                    result.success = true;
+                    if (result.promotion.bookingId.empty()) {
+                        result.promotion = promoteFromWaitlist(train, key, seatNumber);
+                    }
+                } else {
+                    result.error = "Failed to cancel seat. This is unexpected.";
+                }
+            } catch (const SeatNotFoundException& e) {
+                result.error = std::string("Error: ") + e.what();
+            } catch (const StopNotFoundException& e) {
+                result.error = std::string("Error: ") + e.what();
+            }
+        } catch (const TicketNotFoundException& e) {
+            result.error = std::string("Error: ") + e.what();
+        } catch (const TrainNotFoundException& e) {
+            result.error = std::string("Error: ") + e.what();
+        }
+        return result;
+    }
+    
+    // Issues a seatless ticket at the tail of the journey's waitlist;
+    // the caller holds the train's lock
+    std::string addToWaitlist(int trainId, int journeyDate, const std::string& passengerName,
+                              const std::string& fromStop, const std::string& toStop) {
+        BookingResult result = joinWaitlist(trainId, journeyDate, passengerName, fromStop, toStop);
+        if (!result.success) {
+            std::cerr << result.error << std::endl;
+            return "";
+        }
+        reportWaitlisted(result);
+        return result.bookingId;
+    }
+    
+    // The same without printing; the caller holds the train's lock
+    BookingResult joinWaitlist(int trainId, int journeyDate, const std::string& passengerName,
+                               const std::string& fromStop, const std::string& toStop) {
+        Waitlist& waitlist = findWaitlistRef(JourneyKey(journeyDate, trainId));
+        BookingResult result;
+        try {
+            std::string bookingId = generateBookingId();
+            Ticket ticket(bookingId, trainId, 0, passengerName, fromStop, toStop, journeyDate, waitlist.size() + 1);
+            CheckpointGate::Pass pass(changeGate);
+            logTicketIssued(ticket);
+            std::shared_ptr<const WaitlistPlace> place = waitlist.join(bookingId);
+            ticket.setWaitlistPlace(place);
+            bookings.insert(ticket);
+            result.waitlistPosition = place->position();
+            result.success = true;
+            result.bookingId = bookingId;
+            result.ticket = std::make_shared<const Ticket>(ticket);
+        } catch (const std::runtime_error& e) {
+            result.error = std::string("Error creating ticket: ") + e.what();
+        }
+        return result;
+    }
+    
+    static void reportWaitlisted(const BookingResult& result) {
+        std::cout << "No seats available. Ticket added to the waitlist at position "
+                  << result.waitlistPosition << ".\n";
+        result.ticket->displayTicket();
+    }
+    
+    // Gives a freed seat to the head of the journey's waitlist. The head keeps
+    // its place if no seat covers its legs, so the queue stays strictly FIFO.
+    // The caller holds the train's lock.
+    Promotion promoteFromWaitlist(Train& train, const JourneyKey& key, int freedSeat) {
+        Promotion promotion = Promotion();
+        Waitlist* waitlist = findWaitingList(key);
+        if (waitlist == nullptr) {
+            return promotion;
+        }
+        
+        Ticket ticket = bookings.find(waitlist->front());
+        int fromStop = train.getStopIndex(ticket.getBoardingStop());
+        int toStop = train.getStopIndex(ticket.getAlightingStop());
+        
+        int seatNumber = freedSeat;
+        if (!train.bookSpecificSeat(freedSeat, fromStop, toStop)) {
+            try {
+                seatNumber = train.bookSegmentSeat(fromStop, toStop);
+            } catch (const NoSeatsAvailableException&) {
+                return promotion;
+            }
+        }
+        
+        CheckpointGate::Pass pass(changeGate);
+        logSeatConfirmed(ticket.getBookingId(), seatNumber);
+        waitlist->remove(ticket.getBookingId());
+        bookings.confirmSeat(ticket.getBookingId(), seatNumber);
+        promotion.bookingId = ticket.getBookingId();
+        promotion.seatNumber = seatNumber;
+        return promotion;
+    }
+    
+    // Gives a seat its old holder has not yet freed straight to the head of
+    // the journey's waitlist; the promotion is empty if nobody waits. Lock-free
+    // trains use it instead of freeing the seat and promoting afterwards,
+    // since a lock-free booker could claim a freed seat ahead of the
+    // waitlist. Their seats cover the whole route, so any head fits. The
+    // caller holds the train's lock and a pass through the change gate.
+    Promotion handSeatToWaitlist(const JourneyKey& key, int seatNumber) {
+        Promotion promotion = Promotion();
+        Waitlist* waitlist = findWaitingList(key);
+        if (waitlist == nullptr) {
+            return promotion;
+        }
+        std::string bookingId = waitlist->front();
+        logSeatConfirmed(bookingId, seatNumber);
+        waitlist->remove(bookingId);
+        bookings.confirmSeat(bookingId, seatNumber);
+        promotion.bookingId = bookingId;
+        promotion.seatNumber = seatNumber;
+        return promotion;
+    }
+    
+    // A journey's waitlist if anyone is on it, or null; the caller holds the train's lock
+    Waitlist* findWaitingList(const JourneyKey& key) {
+        std::lock_guard<std::mutex> journeysGuard(journeysMutex);
+        auto it = waitlists.find(key);
+        return it == waitlists.end() || it->second.empty() ? nullptr : &it->second;
+    }
+    
+    static void reportPromotion(const Promotion& promotion) {
+        if (!promotion.bookingId.empty()) {
+            std::cout << "Waitlisted ticket " << promotion.bookingId << " is now confirmed with seat "
+                      << promotion.seatNumber << ".\n";
+        }
+    }
+    
+    void logTicketIssued(const Ticket& ticket) {
+        if (!wal) {
+            return;
+        }
+        LogRecord record;
+        record.type = LogRecord::TicketIssued;
+        record.bookingId = ticket.getBookingId();
+        record.trainId = ticket.getTrainId();
+        record.seatNumber = ticket.getSeatNumber();
+        record.passengerName = ticket.getPassengerName();
+        record.boardingStop = ticket.getBoardingStop();
+        record.alightingStop = ticket.getAlightingStop();
+        record.journeyDate = ticket.getJourneyDate();
+        record.waitlistNumber = ticket.getWaitlistNumber();
+        wal->append(record);
+    }
+    
+    void logTicketCancelled(const std::string& bookingId) {
+        if (!wal) {
+            return;
+        }
+        LogRecord record;
+        record.type = LogRecord::TicketCancelled;
+        record.bookingId = bookingId;
+        wal->append(record);
+    }
+    
+    void logSeatConfirmed(const std::string& bookingId, int seatNumber) {
+        if (!wal) {
+            return;
+        }
+        LogRecord record;
+        record.type = LogRecord::SeatConfirmed;
+        record.bookingId = bookingId;
+        record.seatNumber = seatNumber;
+        wal->append(record);
+    }
+    
+    // Blocks until the changes this thread logged are on disk; false if the
+    // log could not be written. A thread running a train batch waits once,
+    // when the batch ends, instead.
+    bool awaitDurable() {
+        if (wal && !TrainLock::inBatch()) {
+            return wal->waitDurable();
+        }
+        return true;
+    }
+    
+    // Refusal for a new booking or cancellation, or an empty string if the
+    // log is writable; after a failed write nothing more is accepted, since
+    // it could not be made durable
+    std::string logFailureError() const {
+        if (wal && wal->hasFailed()) {
+            return "Error: The booking log could not be written; bookings and cancellations are suspended.";
+        }
+        return std::string();
+    }
+    
+    static void reportNotDurable() {
+        std::cerr << "Warning: The booking log could not be written; this change may be lost on a restart.\n";
+    }
+    
+    // Applies one change read back from the write-ahead log. Changes the
+    // loaded tickets already show are skipped, so a log that outlived its
+    // save replays harmlessly.
+    void applyLogRecord(const LogRecord& record) {
+        try {
+            if (record.type == LogRecord::TicketIssued) {
+                BookingIdGenerator::reserveIssued(record.bookingId);
+                if (findBookingTrainId(record.bookingId) != 0) {
+                    return;
+                }
+                Train& train = findJourneyRef(record.trainId, record.journeyDate);
+                Ticket ticket(record.bookingId, record.trainId, record.seatNumber, record.passengerName,
+                              record.boardingStop, record.alightingStop, record.journeyDate, record.waitlistNumber);
+                if (ticket.isWaitlisted()) {
+                    bookings.insert(ticket);
+                    enqueueWaitlisted(JourneyKey(record.journeyDate, record.trainId), record.bookingId);
+                } else if (train.bookSpecificSeat(record.seatNumber, train.getStopIndex(record.boardingStop),
+                                                  train.getStopIndex(record.alightingStop))) {
+                    bookings.insert(ticket);
+                } else {
+                    std::cerr << "Warning: Seat " << record.seatNumber << " on train " << record.trainId
+                              << " is already booked. Skipping logged ticket: " << record.bookingId << std::endl;
+                }
+                return;
+            }
+            
+            Ticket ticket = bookings.find(record.bookingId);
+            JourneyKey key(ticket.getJourneyDate(), ticket.getTrainId());
+            if (record.type == LogRecord::TicketCancelled) {
+                if (ticket.isWaitlisted()) {
+                    findWaitlistRef(key).remove(record.bookingId);
+                } else {
+                    Train& train = findJourneyRef(ticket.getTrainId(), ticket.getJourneyDate());
+                    train.cancelSeat(ticket.getSeatNumber(), train.getStopIndex(ticket.getBoardingStop()),
+                                     train.getStopIndex(ticket.getAlightingStop()));
+                }
+                bookings.erase(record.bookingId);
+            } else if (ticket.isWaitlisted()) {
+                Train& train = findJourneyRef(ticket.getTrainId(), ticket.getJourneyDate());
+                if (!train.bookSpecificSeat(record.seatNumber, train.getStopIndex(ticket.getBoardingStop()),
+                                            train.getStopIndex(ticket.getAlightingStop()))) {
+                    std::cerr << "Warning: Seat " << record.seatNumber << " on train " << ticket.getTrainId()
+                              << " is already booked. Ticket " << record.bookingId << " stays waitlisted."
+                              << std::endl;
+                    return;
+                }
+                findWaitlistRef(key).remove(record.bookingId);
+                bookings.confirmSeat(record.bookingId, record.seatNumber);
+            }
+        } catch (const TicketNotFoundException&) {
+            // Cancelled or confirmed before the tickets were last saved
+        } catch (const std::runtime_error& e) {
+            std::cerr << "Error replaying booking log: " << e.what() << std::endl;
+        }
+    }
+    
+    bool checkBookableDate(int journeyDate) const {
+        std::string error = bookableDateError(journeyDate);
+        if (!error.empty()) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    bool checkLogWritable() const {
+        std::string error = logFailureError();
+        if (!error.empty()) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    // Message explaining why a date cannot be booked, or empty if it can
+    std::string bookableDateError(int journeyDate) const {
+        int today = todayDate();
+        if (journeyDate < today || journeyDate > addDays(today, BOOKING_HORIZON_DAYS)) {
+            return "Error: Journey date must be between " + formatDate(today) + " and " +
+                   formatDate(addDays(today, BOOKING_HORIZON_DAYS)) + ".";
+        }
+        return "";
+    }
+};
+
+// Runs book, cancel and status requests on a pool of worker threads. Each
+// worker owns a deque and takes requests from its front; all requests for a
+// train go to the same worker so that train's seat maps stay in one core's
+// cache. A worker with an empty deque steals from the back of another's, so
+// skewed load still spreads over every core. Results come back as futures.
+class RequestExecutor {
+private:
+    struct Worker {
+        mutable std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+        std::atomic<size_t> steals; // requests this worker took from others
+        std::thread thread;
+        
+        Worker() : steals(0) {}
+    };
+    
+    ReservationSystem& system;
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::atomic<size_t> pending; // queued requests not yet started
+    std::mutex idleMutex;
+    std::condition_variable workAvailable;
+    bool stopping; // guarded by idleMutex
+    
+    bool popOwn(size_t self, std::function<void()>& task) {
+        Worker& worker = *workers[self];
+        std::lock_guard<std::mutex> guard(worker.mutex);
+        if (worker.tasks.empty()) {
+            return false;
+        }
+        task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        pending--;
+        return true;
+    }
+    
+    // Takes the newest request of the first other worker that has one, so
+    // each victim keeps working through its oldest requests in order
+    bool steal(size_t self, std::function<void()>& task) {
+        for (size_t i = 1; i < workers.size(); i++) {
+            Worker& victim = *workers[(self + i) % workers.size()];
+            std::lock_guard<std::mutex> guard(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                pending--;
+                workers[self]->steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    void run(size_t self) {
+        std::function<void()> task;
+        for (;;) {
+            if (popOwn(self, task) || steal(self, task)) {
+                task();
+                continue;
+            }
+            
+            std::unique_lock<std::mutex> idle(idleMutex);
+            if (stopping && pending == 0) {
+                return;
+            }
+            workAvailable.wait(idle, [this]() { return stopping || pending > 0; });
+        }
+    }
+    
+    template <typename Task>
+    std::future<std::invoke_result_t<Task> > submit(int trainId, Task request) {
+        typedef std::invoke_result_t<Task> Result;
+        // packaged_task is move-only, but std::function needs a copyable target
+        std::shared_ptr<std::packaged_task<Result()> > job =
+            std::make_shared<std::packaged_task<Result()> >(request);
+        std::future<Result> result = job->get_future();
+        
+        Worker& worker = *workers[static_cast<size_t>(trainId) % workers.size()];
+        {
+            // Counted under the worker's lock, so no pop can come before the increment
+            std::lock_guard<std::mutex> guard(worker.mutex);
+            pending++;
+            worker.tasks.push_back([job]() { (*job)(); });
+        }
+        {
+            // Taking the lock orders this wake-up after any worker's last check of pending
+            std::lock_guard<std::mutex> idle(idleMutex);
+        }
+        workAvailable.notify_one();
+        return result;
+    }
+    
+public:
+    // Uses one worker per hardware thread unless told otherwise
+    explicit RequestExecutor(ReservationSystem& reservationSystem, size_t workerCount = 0) :
+        system(reservationSystem), pending(0), stopping(false) {
+        if (workerCount == 0) {
+            workerCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        }
+        for (size_t i = 0; i < workerCount; i++) {
+            workers[i]->thread = std::thread(&RequestExecutor::run, this, i);
+        }
+    }
+    
+    // Finishes every queued request before the workers exit
+    ~RequestExecutor() {
+        {
+            std::lock_guard<std::mutex> idle(idleMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) {
+            worker->thread.join();
+        }
+    }
+    
+    RequestExecutor(const RequestExecutor&) = delete;
+    RequestExecutor& operator=(const RequestExecutor&) = delete;
+    
+    std::future<std::string> bookTicket(int trainId, int journeyDate, const std::string& passengerName,
+                                        BerthPreference preference) {
+        ReservationSystem& target = system;
+        return submit(trainId, [&target, trainId, journeyDate, passengerName, preference]() {
+            return target.bookTicket(trainId, journeyDate, passengerName, preference);
+        });
+    }
+    
+    std::future<std::string> bookTicket(int trainId, int journeyDate, const std::string& fromStop,
+                                        const std::string& toStop, const std::string& passengerName) {
+        ReservationSystem& target = system;
+        return submit(trainId, [&target, trainId, journeyDate, fromStop, toStop, passengerName]() {
+            return target.bookTicket(trainId, journeyDate, fromStop, toStop, passengerName);
+        });
+    }
+    
+    std::future<bool> cancelTicket(const std::string& bookingId) {
+        ReservationSystem& target = system;
+        return submit(system.findBookingTrainId(bookingId), [&target, bookingId]() {
+            return target.cancelTicket(bookingId);
+        });
+    }
+    
+    std::future<bool> checkTicketStatus(const std::string& bookingId) {
+        ReservationSystem& target = system;
+        return submit(system.findBookingTrainId(bookingId), [&target, bookingId]() {
+            return target.checkTicketStatus(bookingId);
+        });
+    }
+    
+    size_t workerCount() const {
+        return workers.size();
+    }
+    
+    // Requests waiting in one worker's deque
+    size_t queueDepth(size_t worker) const {
+        std::lock_guard<std::mutex> guard(workers[worker]->mutex);
+        return workers[worker]->tasks.size();
+    }
+    
+    // Requests waiting across all workers
+    size_t queueDepth() const {
+        return pending;
+    }
+    
+    size_t stealCount(size_t worker) const {
+        return workers[worker]->steals;
+    }
+    
+    size_t stealCount() const {
+        size_t steals = 0;
+        for (const auto& worker : workers) {
+            steals += worker->steals;
+        }
+        return steals;
+    }
+};
+
+// Bounded queue for many producers and one consumer that takes no locks.
+// Every slot carries a sequence number saying whose turn it is: a producer
+// claims a position by compare-and-swap on the tail and publishes its value by
+// advancing the slot's sequence, and the consumer reads slots in order.
+template <typename T>
+class MpscRing {
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+    
+    std::unique_ptr<Slot[]> slots;
+    size_t capacity;
+    std::atomic<size_t> tail; // next position producers claim
+    // Keeps the producers' tail and the consumer's head on separate cache lines
+    char padding[64];
+    std::atomic<size_t> head; // next position the consumer reads; written by it alone
+    
+public:
+    // Capacity is rounded up to a power of two
+    explicit MpscRing(size_t minCapacity) : capacity(1), tail(0), head(0) {
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        slots.reset(new Slot[capacity]);
+        for (size_t i = 0; i < capacity; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+    
+    // Moves value in and returns true, or returns false with value untouched if the ring is full
+    bool tryPush(T& value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[position & (capacity - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (sequence < position) {
+                // The consumer has not yet freed this slot from the previous lap
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    // Consumer only
+    bool tryPop(T& value) {
+        size_t position = head.load(std::memory_order_relaxed);
+        Slot& slot = slots[position & (capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+        value = std::move(slot.value);
+        slot.sequence.store(position + capacity, std::memory_order_release);
+        head.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    // Consumer only
+    bool empty() const {
+        size_t position = head.load(std::memory_order_relaxed);
+        return slots[position & (capacity - 1)].sequence.load(std::memory_order_acquire) != position + 1;
+    }
+    
+    // Approximate number of queued values; exact only when no push or pop is running
+    size_t size() const {
+        size_t claimed = tail.load(std::memory_order_relaxed);
+        size_t consumed = head.load(std::memory_order_relaxed);
+        return claimed > consumed ? claimed - consumed : 0;
+    }
+};
+
+// Runs the requests for chosen trains on one owner thread per train. Callers
+// push requests into the train's bounded lock-free ring; the owner drains up
+// to BATCH_SIZE at a time and applies them under one hold of the train lock,
+// so the train's seat maps stay in that core's cache across the batch and no
+// other thread contends for them. Requests for trains without an owner run on
+// the calling thread. Results come back as futures, which become ready only
+// once the batch's changes are durable.
+class TrainActorPipeline {
+private:
+    static const size_t RING_CAPACITY = 1024;
+    static const size_t BATCH_SIZE = 64;
+    
+    struct Actor {
+        int trainId;
+        MpscRing<std::function<void()> > inbox;
+        std::atomic<bool> sleeping; // owner found the inbox empty and may be waiting
+        std::mutex idleMutex;
+        std::condition_variable wake;
+        bool stopping; // guarded by idleMutex
+        std::atomic<size_t> batches;
+        std::atomic<size_t> handled;
+        std::thread thread;
+        
+        explicit Actor(int id) :
+            trainId(id), inbox(RING_CAPACITY), sleeping(false), stopping(false), batches(0), handled(0) {}
+    };
+    
+    ReservationSystem& system;
+    std::vector<std::unique_ptr<Actor> > actors;
+    
+    Actor* findActor(int trainId) const {
+        for (const auto& actor : actors) {
+            if (actor->trainId == trainId) {
+                return actor.get();
+            }
+        }
+        return nullptr;
+    }
+    
+    // Results of the owner thread's current batch, handed to their futures
+    // after runTrainBatch has waited for the log
+    static std::vector<std::function<void()> >& pendingResults() {
+        static thread_local std::vector<std::function<void()> > results;
+        return results;
+    }
+    
+    void run(Actor& actor) {
+        std::vector<std::function<void()> > batch;
+        batch.reserve(BATCH_SIZE);
+        std::function<void()> request;
+        for (;;) {
+            while (batch.size() < BATCH_SIZE && actor.inbox.tryPop(request)) {
+                batch.push_back(std::move(request));
+            }
+            if (!batch.empty()) {
+                system.runTrainBatch(actor.trainId, batch);
+                for (auto& deliver : pendingResults()) {
+                    deliver();
+                }
+                pendingResults().clear();
+                actor.handled += batch.size();
+                actor.batches++;
+                batch.clear();
+                continue;
+            }
+            
+            std::unique_lock<std::mutex> idle(actor.idleMutex);
+            actor.sleeping.store(true);
+            // Pairs with the fence in submit: either the producer sees sleeping
+            // set, or this thread sees its request below
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (actor.stopping && actor.inbox.empty()) {
+                return;
+            }
+            actor.wake.wait(idle, [&actor]() { return actor.stopping || !actor.inbox.empty(); });
+            actor.sleeping.store(false);
+        }
+    }
+    
+    template <typename Task>
+    std::future<std::invoke_result_t<Task> > submit(int trainId, Task request) {
+        typedef std::invoke_result_t<Task> Result;
+        std::shared_ptr<std::promise<Result> > promise = std::make_shared<std::promise<Result> >();
+        std::future<Result> result = promise->get_future();
+        
+        Actor* actor = findActor(trainId);
+        if (actor == nullptr) {
+            // Not part of a batch, so the call waits for the log itself
+            try {
+                promise->set_value(request());
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+            return result;
+        }
+        
+        std::function<void()> task([promise, request]() {
+            std::shared_ptr<Result> value;
+            std::exception_ptr error;
+            try {
+                value = std::make_shared<Result>(request());
+            } catch (...) {
+                error = std::current_exception();
+            }
+            pendingResults().push_back([promise, value, error]() {
+                if (error) {
+                    promise->set_exception(error);
+                } else {
+                    promise->set_value(*value);
+                }
+            });
+        });
+        // A full ring holds the caller back until the owner catches up
+        while (!actor->inbox.tryPush(task)) {
+            std::this_thread::yield();
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (actor->sleeping.load()) {
+            {
+                // Taking the lock orders this wake-up after the owner's last check of the inbox
+                std::lock_guard<std::mutex> idle(actor->idleMutex);
+            }
+            actor->wake.notify_one();
+        }
+        return result;
+    }
+    
+public:
+    // Starts one owner thread for each listed train
+    TrainActorPipeline(ReservationSystem& reservationSystem, const std::vector<int>& trainIds) :
+        system(reservationSystem) {
+        for (int trainId : trainIds) {
+            if (findActor(trainId) == nullptr) {
+                actors.push_back(std::unique_ptr<Actor>(new Actor(trainId)));
+            }
+        }
+        for (auto& actor : actors) {
+            actor->thread = std::thread(&TrainActorPipeline::run, this, std::ref(*actor));
+        }
+    }
+    
+    // Finishes every queued request before the owners exit
+    ~TrainActorPipeline() {
+        for (auto& actor : actors) {
+            {
+                std::lock_guard<std::mutex> idle(actor->idleMutex);
+                actor->stopping = true;
+            }
+            actor->wake.notify_one();
+        }
+        for (auto& actor : actors) {
+            actor->thread.join();
+        }
+    }
+    
+    TrainActorPipeline(const TrainActorPipeline&) = delete;
+    TrainActorPipeline& operator=(const TrainActorPipeline&) = delete;
+    
+    bool ownsTrain(int trainId) const {
+        return findActor(trainId) != nullptr;
+    }
+    
+    std::future<std::string> bookTicket(int trainId, int journeyDate, const std::string& passengerName,
+                                        BerthPreference preference) {
+        ReservationSystem& target = system;
+        return submit(trainId, [&target, trainId, journeyDate, passengerName, preference]() {
+            return target.bookTicket(trainId, journeyDate, passengerName, preference);
+        });
+    }
+    
+    std::future<std::string> bookTicket(int trainId, int journeyDate, const std::string& fromStop,
+                                        const std::string& toStop, const std::string& passengerName) {
+        ReservationSystem& target = system;
+        return submit(trainId, [&target, trainId, journeyDate, fromStop, toStop, passengerName]() {
+            return target.bookTicket(trainId, journeyDate, fromStop, toStop, passengerName);
+        });
+    }
+    
+    std::future<bool> cancelTicket(const std::string& bookingId) {
+        ReservationSystem& target = system;
+        return submit(system.findBookingTrainId(bookingId), [&target, bookingId]() {
+            return target.cancelTicket(bookingId);
+        });
+    }
+    
+    std::future<bool> checkTicketStatus(const std::string& bookingId) {
+        ReservationSystem& target = system;
+        return submit(system.findBookingTrainId(bookingId), [&target, bookingId]() {
+            return target.checkTicketStatus(bookingId);
+        });
+    }
+    
+    // Requests waiting in a train's ring; 0 for trains without an owner
+    size_t queueDepth(int trainId) const {
+        Actor* actor = findActor(trainId);
+        return actor != nullptr ? actor->inbox.size() : 0;
+    }
+    
+    // Requests an owner has applied, and the batches it applied them in
+    size_t handledCount(int trainId) const {
+        Actor* actor = findActor(trainId);
+        return actor != nullptr ? actor->handled.load() : 0;
+    }
+    
+    size_t batchCount(int trainId) const {
+        Actor* actor = findActor(trainId);
+        return actor != nullptr ? actor->batches.load() : 0;
+    }
+};
+
+// Admission layer in front of ReservationSystem::bookTicket for booking
+// rushes. Each train has a bounded queue; a request for a journey with no free
+// seat is refused before it takes a queue slot, and again when it reaches the
+// front, instead of being waitlisted. Workers serve the trains with waiting
+// requests in weighted round robin: a train of weight w dispatches up to w
+// requests per turn, so a hot train cannot starve the others. Queue wait times
+// are recorded per train.
+class BookingAdmission {
+public:
+    struct WaitStats {
+        size_t dispatched;
+        long long totalWaitMicros;
+        long long maxWaitMicros;
+        
+        double averageWaitMicros() const {
+            return dispatched == 0 ? 0.0 : static_cast<double>(totalWaitMicros) / dispatched;
+        }
+    };
+    
+private:
+    typedef std::chrono::steady_clock Clock;
+    
+    struct Pending {
+        std::function<void()> task;
+        Clock::time_point enqueued;
+    };
+    
+    struct TrainQueue {
+        std::deque<Pending> requests;
+        int weight;
+        int credit; // requests left in the train's current turn
+        WaitStats wait;
+        
+        TrainQueue() : weight(1), credit(0) {
+            wait.dispatched = 0;
+            wait.totalWaitMicros = 0;
+            wait.maxWaitMicros = 0;
+        }
+    };
+    
+    ReservationSystem& system;
+    size_t queueCapacity;
+    std::map<int, TrainQueue> queues;
+    std::deque<int> activeTrains; // trains with waiting requests; the front one has the turn
+    mutable std::mutex mutex;     // guards queues and activeTrains
+    std::condition_variable workAvailable;
+    bool stopping;                // guarded by mutex
+    std::atomic<size_t> rejections;
+    std::vector<std::thread> workers;
+    
+    static std::string reject(const std::runtime_error& reason) {
+        std::cerr << "Error: " << reason.what() << std::endl;
+        return "";
+    }
+    
+    // Takes the next request in weighted round robin and records its wait; mutex is held
+    Pending takeNext() {
+        int trainId = activeTrains.front();
+        TrainQueue& queue = queues[trainId];
+        Pending request = std::move(queue.requests.front());
+        queue.requests.pop_front();
+        
+        long long waited = std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - request.enqueued).count();
+        queue.wait.dispatched++;
+        queue.wait.totalWaitMicros += waited;
+        queue.wait.maxWaitMicros = std::max(queue.wait.maxWaitMicros, waited);
+        
+        if (queue.requests.empty()) {
+            activeTrains.pop_front();
+        } else if (--queue.credit == 0) {
+            queue.credit = queue.weight;
+            activeTrains.pop_front();
+            activeTrains.push_back(trainId);
+        }
+        return request;
+    }
+    
+    void run() {
+        for (;;) {
+            Pending request;
+            {
+                std::unique_lock<std::mutex> guard(mutex);
+                workAvailable.wait(guard, [this]() { return stopping || !activeTrains.empty(); });
+                if (activeTrains.empty()) {
+                    return;
+                }
+                request = takeNext();
+            }
+            request.task();
+        }
+    }
+    
+public:
+    // Uses one worker per hardware thread unless told otherwise
+    explicit BookingAdmission(ReservationSystem& reservationSystem, size_t capacityPerTrain = 256,
+                              size_t workerCount = 0) :
+        system(reservationSystem), queueCapacity(capacityPerTrain), stopping(false), rejections(0) {
+        if (capacityPerTrain == 0) {
+            throw InvalidInputException("queue capacity must be positive");
+        }
+        if (workerCount == 0) {
+            workerCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.push_back(std::thread(&BookingAdmission::run, this));
+        }
+    }
+    
+    // Finishes every admitted request before the workers exit
+    ~BookingAdmission() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    BookingAdmission(const BookingAdmission&) = delete;
+    BookingAdmission& operator=(const BookingAdmission&) = delete;
+    
+    // Requests a train may dispatch per turn; every train starts at 1
+    void setWeight(int trainId, int weight) {
+        if (weight <= 0) {
+            throw InvalidInputException("train weight must be positive");
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        queues[trainId].weight = weight;
+    }
+    
+    // Queues a whole-route booking. A refused request gets an empty booking ID
+    // at once, with the reason printed, like any other failed booking.
+    std::future<std::string> bookTicket(int trainId, int journeyDate, const std::string& passengerName,
+                                        BerthPreference preference) {
+        try {
+            if (system.getAvailableSeats(trainId, journeyDate) == 0) {
+                throw NoSeatsAvailableException(trainId);
+            }
+            
+            std::shared_ptr<std::packaged_task<std::string()> > job =
+                std::make_shared<std::packaged_task<std::string()> >(
+                    [this, trainId, journeyDate, passengerName, preference]() {
+                        // The last seats may have gone while the request waited
+                        if (system.getAvailableSeats(trainId, journeyDate) == 0) {
+                            rejections++;
+                            return reject(NoSeatsAvailableException(trainId));
+                        }
+                        return system.bookTicket(trainId, journeyDate, passengerName, preference);
+                    });
+            std::future<std::string> result = job->get_future();
+            
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                TrainQueue& queue = queues[trainId];
+                if (queue.requests.size() >= queueCapacity) {
+                    throw TrainBusyException(trainId);
+                }
+                if (queue.requests.empty()) {
+                    queue.credit = queue.weight;
+                    activeTrains.push_back(trainId);
+                }
+                Pending request = { [job]() { (*job)(); }, Clock::now() };
+                queue.requests.push_back(std::move(request));
+            }
+            workAvailable.notify_one();
+            return result;
+        } catch (const std::runtime_error& e) {
+            // Covers TrainNotFoundException, NoSeatsAvailableException and TrainBusyException
+            rejections++;
+            std::promise<std::string> refused;
+            refused.set_value(reject(e));
+            return refused.get_future();
+        }
+    }
+    
+    // Requests waiting for one train
+    size_t queueDepth(int trainId) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = queues.find(trainId);
+        return it == queues.end() ? 0 : it->second.requests.size();
+    }
+    
+    // Requests refused without being queued or on reaching the front
+    size_t rejectedCount() const {
+        return rejections;
+    }
+    
+    // Time requests for one train spent queued before a worker took them
+    WaitStats queueWait(int trainId) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = queues.find(trainId);
+        return it == queues.end() ? TrainQueue().wait : it->second.wait;
+    }
+    
+    // The same across all trains
+    WaitStats queueWait() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        WaitStats total = TrainQueue().wait;
+        for (const auto& entry : queues) {
+            total.dispatched += entry.second.wait.dispatched;
+            total.totalWaitMicros += entry.second.wait.totalWaitMicros;
+            total.maxWaitMicros = std::max(total.maxWaitMicros, entry.second.wait.maxWaitMicros);
+        }
+        return total;
+    }
+};
+
+// Checkpoints a reservation system on a background thread at a fixed
+// interval, so the write-ahead log replayed after a crash never holds much
+// more than one interval of changes
+class CheckpointScheduler {
+private:
+    ReservationSystem& system;
+    std::string snapshotFile;
+    std::chrono::milliseconds interval;
+    std::mutex mutex;
+    std::condition_variable stopRequested;
+    bool stopping; // guarded by mutex
+    std::atomic<size_t> completed;
+    std::thread worker;
+    
+    void run() {
+        std::unique_lock<std::mutex> guard(mutex);
+        while (!stopRequested.wait_for(guard, interval, [this]() { return stopping; })) {
+            guard.unlock();
+            try {
+                if (system.checkpoint(snapshotFile)) {
+                    completed++;
+                }
+            } catch (const FileIOException& e) {
+                std::cerr << "Error: " << e.what() << ". Checkpoint skipped; the log keeps every change."
+                          << std::endl;
+            } catch (const SnapshotFormatException& e) {
+                std::cerr << "Error: " << e.what() << ". Checkpoint skipped; the log keeps every change."
+                          << std::endl;
+            }
+            guard.lock();
+        }
+    }
+    
+public:
+    CheckpointScheduler(ReservationSystem& target, const std::string& snapshot, std::chrono::milliseconds every) :
+        system(target), snapshotFile(snapshot), interval(every), stopping(false), completed(0) {
+        worker = std::thread(&CheckpointScheduler::run, this);
+    }
+    
+    // Stops without a final checkpoint; call ReservationSystem::checkpoint for one
+    ~CheckpointScheduler() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        stopRequested.notify_one();
+        worker.join();
+    }
+    
+    CheckpointScheduler(const CheckpointScheduler&) = delete;
+    CheckpointScheduler& operator=(const CheckpointScheduler&) = delete;
+    
+    // Checkpoints written so far; intervals with no changes write none
+    size_t checkpointCount() const {
+        return completed;
+    }
+};
+
+#if defined(__cpp_impl_coroutine)
+// Awaitable API, built when compiling as C++20 or later.
+
+// Coroutine that starts at once and owns nothing; used to bridge an
+// AsyncTask to code that is not a coroutine
+struct DetachedCoroutine {
+    struct promise_type {
+        DetachedCoroutine get_return_object() { return DetachedCoroutine(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Lazily started coroutine producing a T. Awaiting it starts it and resumes
+// the awaiting coroutine when it finishes; get() runs it from a plain thread.
+template <typename T>
+class AsyncTask {
+private:
+    // Hands control back to whoever awaited the task
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept {
+            std::coroutine_handle<> continuation = finished.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        
+        void await_resume() const noexcept {}
+    };
+    
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+        
+        AsyncTask get_return_object() {
+            return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_value(T result) { value = std::move(result); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+    
+private:
+    std::coroutine_handle<promise_type> handle;
+    
+    explicit AsyncTask(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
+    
+    static DetachedCoroutine forward(AsyncTask task, std::shared_ptr<std::promise<T> > result) {
+        try {
+            result->set_value(co_await task);
+        } catch (...) {
+            result->set_exception(std::current_exception());
+        }
+    }
+    
+public:
+    AsyncTask(AsyncTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    
+    ~AsyncTask() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+    
+    AsyncTask(const AsyncTask&) = delete;
+    AsyncTask& operator=(const AsyncTask&) = delete;
+    
+    bool await_ready() const noexcept { return false; }
+    
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    
+    T await_resume() {
+        if (handle.promise().error) {
+            std::rethrow_exception(handle.promise().error);
+        }
+        return std::move(*handle.promise().value);
+    }
+    
+    // Runs the task to completion, blocking the calling thread
+    T get() && {
+        std::shared_ptr<std::promise<T> > result = std::make_shared<std::promise<T> >();
+        std::future<T> ready = result->get_future();
+        forward(std::move(*this), result);
+        return ready.get();
+    }
+};
+
+// Small thread pool that resumes coroutines. Awaiting schedule() moves the
+// awaiting coroutine onto one of its threads, behind those already waiting.
+class CoroutineExecutor {
+private:
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::deque<std::coroutine_handle<> > ready; // guarded by mutex
+    bool stopping;                              // guarded by mutex
+    std::vector<std::thread> threads;
+    
+    // Notifies under the mutex: the caller may be another thread, such as the
+    // log's flusher, and the coroutine it wakes may finish and let the
+    // executor be destroyed before an unlocked notify would return
+    void enqueue(std::coroutine_handle<> coroutine) {
+        std::lock_guard<std::mutex> guard(mutex);
+        ready.push_back(coroutine);
+        workAvailable.notify_one();
+    }
+    
+    void run() {
+        for (;;) {
+            std::coroutine_handle<> coroutine;
+            {
+                std::unique_lock<std::mutex> guard(mutex);
+                workAvailable.wait(guard, [this]() { return stopping || !ready.empty(); });
+                if (ready.empty()) {
+                    return;
+                }
+                coroutine = ready.front();
+                ready.pop_front();
+            }
+            coroutine.resume();
+        }
+    }
+    
+public:
+    struct ScheduleAwaiter {
+        CoroutineExecutor& executor;
+        
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> coroutine) { executor.enqueue(coroutine); }
+        void await_resume() const noexcept {}
+    };
+    
+    // Uses one thread per hardware thread unless told otherwise
+    explicit CoroutineExecutor(size_t threadCount = 0) : stopping(false) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < threadCount; i++) {
+            threads.push_back(std::thread(&CoroutineExecutor::run, this));
+        }
+    }
+    
+    // Resumes every queued coroutine before the threads exit
+    ~CoroutineExecutor() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    
+    CoroutineExecutor(const CoroutineExecutor&) = delete;
+    CoroutineExecutor& operator=(const CoroutineExecutor&) = delete;
+    
+    ScheduleAwaiter schedule() {
+        return ScheduleAwaiter{*this};
+    }
+    
+    // Resumes a suspended coroutine on one of the threads; lets other code
+    // wake a coroutine that is waiting on it
+    void resume(std::coroutine_handle<> coroutine) {
+        enqueue(coroutine);
+    }
+};
+
+// Awaitable book, cancel and status calls that return structured results and
+// print nothing. They run on a CoroutineExecutor. A coroutine that finds its
+// train's lock held joins the lock's queue and is resumed on the executor
+// when the lock is released, so its thread moves on to other requests
+// instead of blocking or polling. Bookings on lock-free trains and status
+// checks take no train lock. Once a change is logged the coroutine suspends
+// until the log's flusher has made it durable.
+class AsyncReservations {
+private:
+    ReservationSystem& system;
+    CoroutineExecutor& executor;
+    
+    // Runs an operation under a train's lock: resumes with true once it has
+    // run, or with false after waiting for the lock, to be awaited again
+    template <typename Operation>
+    struct TrainTurn {
+        AsyncReservations& owner;
+        int trainId;
+        Operation& operation;
+        bool ran = false;
+        
+        bool await_ready() const noexcept { return false; }
+        
+        bool await_suspend(std::coroutine_handle<> coroutine) {
+            CoroutineExecutor& executor = owner.executor;
+            if (owner.system.tryRunOnTrain(trainId, operation, [&executor, coroutine]() {
+                    executor.resume(coroutine);
+                })) {
+                ran = true;
+                return false;
+            }
+            // The coroutine may already be running elsewhere; touch nothing more
+            return true;
+        }
+        
+        bool await_resume() const noexcept { return ran; }
+    };
+    
+    template <typename Operation>
+    TrainTurn<Operation> onTrain(int trainId, Operation& operation) {
+        return TrainTurn<Operation>{*this, trainId, operation};
+    }
+    
+    // Resumes once the changes this thread logged are durable, with false if
+    // the log could not be written
+    struct Durable {
+        AsyncReservations& owner;
+        bool written = true;
+        
+        bool await_ready() const noexcept { return false; }
+        
+        bool await_suspend(std::coroutine_handle<> coroutine) {
+            CoroutineExecutor& executor = owner.executor;
+            bool* result = &written;
+            return owner.system.whenDurable([&executor, coroutine, result](bool ok) {
+                *result = ok;
+                executor.resume(coroutine);
+            });
+        }
+        
+        bool await_resume() const noexcept { return written; }
+    };
+    
+    Durable durable() {
+        return Durable{*this};
+    }
+    
+public:
+    AsyncReservations(ReservationSystem& reservationSystem, CoroutineExecutor& coroutineExecutor) :
+        system(reservationSystem), executor(coroutineExecutor) {}
+    
+    // Arguments are taken by value because the coroutine outlives the call
+    AsyncTask<BookingResult> bookTicket(int trainId, int journeyDate, std::string passengerName,
+                                        BerthPreference preference) {
+        co_await executor.schedule();
+        BookingResult result;
+        if (system.claimsSeatsWithoutLock(trainId)) {
+            result = system.bookSeatWithoutSync(trainId, journeyDate, passengerName, preference);
+        } else {
+            auto book = [&]() { result = system.bookSeat(trainId, journeyDate, passengerName, preference); };
+            while (!co_await onTrain(trainId, book)) {
+                // Woken by a release of the lock; try again
+            }
+        }
+        result.durable = co_await durable();
+        co_return result;
+    }
+    
+    AsyncTask<CancelResult> cancelTicket(std::string bookingId) {
+        co_await executor.schedule();
+        CancelResult result;
+        auto cancel = [&]() { result = system.cancelBooking(bookingId); };
+        while (!co_await onTrain(system.findBookingTrainId(bookingId), cancel)) {
+            // Woken by a release of the lock; try again
+        }
+        result.durable = co_await durable();
+        co_return result;
+    }
+    
+    AsyncTask<StatusResult> checkTicketStatus(std::string bookingId) {
+        co_await executor.schedule();
+        co_return system.findTicketStatus(bookingId);
+    }
+};
+#endif
+
+// The benchmarks and tests include this file with RAILWAY_NO_MAIN defined,
+// leaving out the menu and main
+#ifndef RAILWAY_NO_MAIN
+
+// Function to safely get integer input from user
+int getIntInput() {
+    int value;
+    std::string input;
+    
+    std::getline(std::cin, input);
+    
+    try {
+        // Handle empty input
+        if (input.empty()) {
+            throw InvalidInputException("input is empty");
+        }
+        
+        // Check if input contains only digits
+        for (char c : input) {
+            if (!std::isdigit(c)) {
+                throw InvalidInputException("input contains non-numeric characters");
+            }
+        }
+        
+        value = std::stoi(input);
+        
+        // Check if value is in reasonable range
+        if (value < 0 || value > 10000) {
+            throw InvalidInputException("input is out of reasonable range (0-10000)");
+        }
+        
+        return value;
+        
+    } catch (const InvalidInputException& e) {
+        std::cerr << "Invalid input: " << e.what() << std::endl;
+        std::cerr << "Please enter a valid number." << std::endl;
+        return -1; // Indicate error
+    } catch (const std::out_of_range&) {
+        std::cerr << "Invalid input: number is too large" << std::endl;
+        return -1; // Indicate error
+    } catch (const std::exception& e) {
+        std::cerr << "Unexpected error: " << e.what() << std::endl;
+        return -1; // Indicate error
+    }
+}
+
+// Function to read a journey date from the user; blank input means today
+int getDateInput() {
+    std::string input;
+    std::getline(std::cin, input);
+    
+    if (input.empty()) {
+        return todayDate();
+    }
+    
+    try {
+        return parseDate(input);
+    } catch (const InvalidInputException& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Please enter a date as YYYY-MM-DD." << std::endl;
+        return -1; // Indicate error
+    }
+}
+
+void displayMainMenu() {
+    std::cout << "\n====== RAILWAY RESERVATION SYSTEM ======\n";
+    std::cout << "1. Display All Trains\n";
+    std::cout << "2. Check Seat Availability\n";
+    std::cout << "3. Book a Ticket\n";
+    std::cout << "4. Cancel a Ticket\n";
+    std::cout << "5. Check Ticket Status\n";
+    std::cout << "6. Book Group Tickets (Adjacent Seats)\n";
+    std::cout << "7. Hold a Seat (Pending Payment)\n";
+    std::cout << "8. Confirm a Held Seat\n";
+    std::cout << "9. Release a Held Seat\n";
+    std::cout << "0. Exit\n";
+    std::cout << "========================================\n";
+    std::cout << "Enter your choice: ";
+}
+
+int main() {
+    ReservationSystem reservationSystem;
+    int choice;
+    
+    std::cout << "Welcome to Railway Reservation System!\n";
+    
+    try {
+        // Booking IDs are scrambled with a secret key kept beside the
+        // snapshot; it is created on the first run
+        BookingIdGenerator::useKeyFile("reservations.key");
+        
+        // Load the last checkpoint's snapshot, or import the CSV files when
+        // there is none yet
+        bool restored = false;
+        try {
+            reservationSystem.loadSnapshot("reservations.snap");
+            restored = true;
+        } catch (const FileIOException& e) {
+            std::cout << "Note: " << e.what() << ". Importing CSV files." << std::endl;
+        } catch (const SnapshotFormatException& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            std::cerr << "Importing CSV files instead; bookings since they were saved may be missing." << std::endl;
+        }
+        
+        if (!restored) {
+            try {
+                reservationSystem.loadTrainsFromCSV("trains.csv");
+            } catch (const FileIOException& e) {
+                std::cout << "Note: " << e.what() << ". Using default trains." << std::endl;
+            }
+            
+            try {
+                reservationSystem.loadTicketsFromCSV("tickets.csv");
+            } catch (const FileIOException& e) {
+                std::cout << "Note: " << e.what() << ". Starting with no existing bookings." << std::endl;
+            }
+        }
+        
+        // Bookings made after the last save are replayed from the log, and
+        // every booking and cancellation is logged before it is confirmed
+        try {
+            reservationSystem.openWriteAheadLog("bookings.wal");
+        } catch (const FileIOException& e) {
+            std::cout << "Note: " << e.what() << ". Bookings are saved only at checkpoints." << std::endl;
+        }
+        
+        // Journeys that have already departed are no longer on sale
+        reservationSystem.retireJourneysBefore(todayDate());
+        
+        // Bookings, cancellations and status checks run on the worker pool
+        RequestExecutor executor(reservationSystem);
+        
+        // Save every minute, so a restart replays at most a minute of the log
+        CheckpointScheduler checkpoints(reservationSystem, "reservations.snap", std::chrono::minutes(1));
+        
+        do {
+            displayMainMenu();
+            choice = getIntInput();
+            
+            // Handle invalid input
+            if (choice < 0) {
+                std::cout << "Please try again.\n";
+                continue;
+            }
+            
+            // Holds whose payment window has passed go back on sale
+            reservationSystem.expireHolds();
+            
+            switch (choice) {
+                case 1: {
+                    std::cout << "Enter Journey Date (YYYY-MM-DD, blank for today): ";
+                    int journeyDate = getDateInput();
+                    if (journeyDate > 0) {
+                        reservationSystem.displayAllTrains(journeyDate);
+                    }
+                    break;
+                }
+                case 2: {
+                    std::cout << "Enter Train ID: ";
+                    int trainId = getIntInput();
+                    if (trainId <= 0) {
+                        break;
+                    }
+                    
+                    std::cout << "Enter Journey Date (YYYY-MM-DD, blank for today): ";
+                    int journeyDate = getDateInput();
+                    if (journeyDate > 0) {
+                        reservationSystem.checkSeatAvailability(trainId, journeyDate);
+                    }
+                    break;
+                }
+                case 3: {
+                    std::cout << "Enter Train ID: ";
+                    int trainId = getIntInput();
+                    if (trainId <= 0) {
+                        break;
+                    }
+                    
+                    std::cout << "Enter Journey Date (YYYY-MM-DD, blank for today): ";
+                    int journeyDate = getDateInput();
+                    if (journeyDate <= 0) {
+                        break;
+                    }
+                    
+                    std::string passengerName;
+                    std::cout << "Enter Passenger Name: ";
+                    std::getline(std::cin, passengerName);
+                    
+                    if (passengerName.empty()) {
+                        std::cerr << "Error: Passenger name cannot be empty.\n";
+                        break;
+                    }
+                    
+                    std::string fromStop;
+                    std::string toStop;
+                    std::cout << "Enter Boarding Stop (leave blank for the whole route): ";
+                    std::getline(std::cin, fromStop);
+                    if (!fromStop.empty()) {
+                        std::cout << "Enter Alighting Stop: ";
+                        std::getline(std::cin, toStop);
+                        
+                        std::string result = executor.bookTicket(trainId, journeyDate, fromStop, toStop,
+                                                                 passengerName).get();
+                        if (result.empty()) {
+                            std::cout << "Ticket booking failed.\n";
+                        }
+                        break;
+                    }
+                    
+                    std::cout << "Berth Preference (0=None, 1=Lower, 2=Middle, 3=Upper, 4=Side): ";
+                    int preference = getIntInput();
+                    if (preference < 0 || preference >= BERTH_PREFERENCE_COUNT) {
+                        std::cerr << "Error: Invalid berth preference.\n";
+                        break;
+                    }
+                    
+                    std::string result = executor.bookTicket(trainId, journeyDate, passengerName,
+                                                             static_cast<BerthPreference>(preference)).get();
+                    if (result.empty()) {
+                        std::cout << "Ticket booking failed.\n";
+                    }
+                    break;
+                }
+                case 4: {
+                    std::string bookingId;
+                    std::cout << "Enter Booking ID: ";
+                    std::getline(std::cin, bookingId);
+                    
+                    if (bookingId.empty()) {
+                        std::cerr << "Error: Booking ID cannot be empty.\n";
+                        break;
+                    }
+                    
+                    executor.cancelTicket(bookingId).get();
+                    break;
+                }
+                case 5: {
+                    std::string bookingId;
+                    std::cout << "Enter Booking ID: ";
+                    std::getline(std::cin, bookingId);
+                    
+                    if (bookingId.empty()) {
+                        std::cerr << "Error: Booking ID cannot be empty.\n";
+                        break;
+                    }
+                    
+                    executor.checkTicketStatus(bookingId).get();
+                    break;
+                }
+                case 6: {
+                    std::cout << "Enter Train ID: ";
+                    int trainId = getIntInput();
+                    if (trainId <= 0) {
+                        break;
+                    }
+                    
+                    std::cout << "Enter Journey Date (YYYY-MM-DD, blank for today): ";
+                    int journeyDate = getDateInput();
+                    if (journeyDate <= 0) {
+                        break;
+                    }
+                    
+                    std::cout << "Enter Number of Passengers: ";
+                    int count = getIntInput();
+                    if (count <= 0) {
+                        std::cerr << "Error: Number of passengers must be positive.\n";
+                        break;
+                    }
+                    
+                    std::vector<std::string> passengerNames;
+                    for (int i = 1; i <= count; i++) {
+                        std::string passengerName;
+                        std::cout << "Enter Name of Passenger " << i << ": ";
+                        std::getline(std::cin, passengerName);
+                        passengerNames.push_back(passengerName);
+                    }
+                    
+                    std::cout << "Keep the group in one coach? (1=Yes, 0=No): ";
+                    int sameCoach = getIntInput();
+                    if (sameCoach != 0 && sameCoach != 1) {
+                        std::cerr << "Error: Please enter 1 or 0.\n";
+                        break;
+                    }
+                    
+                    std::vector<std::string> result =
+                        reservationSystem.bookGroupTickets(trainId, journeyDate, passengerNames, sameCoach == 1);
+                    if (result.empty()) {
+                        std::cout << "Group booking failed.\n";
+                    }
+                    break;
+                }
+                case 7: {
+                    std::cout << "Enter Train ID: ";
+                    int trainId = getIntInput();
+                    if (trainId <= 0) {
+                        break;
+                    }
+                    
+                    std::cout << "Enter Journey Date (YYYY-MM-DD, blank for today): ";
+                    int journeyDate = getDateInput();
+                    if (journeyDate <= 0) {
+                        break;
+                    }
+                    
+                    std::string passengerName;
+                    std::cout << "Enter Passenger Name: ";
+                    std::getline(std::cin, passengerName);
+                    
+                    if (reservationSystem.holdSeat(trainId, journeyDate, passengerName).empty()) {
+                        std::cout << "Seat hold failed.\n";
+                    }
+                    break;
+                }
+                case 8:
+                case 9: {
+                    std::string holdId;
+                    std::cout << "Enter Hold ID: ";
+                    std::getline(std::cin, holdId);
+                    
+                    if (holdId.empty()) {
+                        std::cerr << "Error: Hold ID cannot be empty.\n";
+                        break;
+                    }
+                    
+                    if (choice == 8) {
+                        reservationSystem.confirmHold(holdId);
+                    } else {
+                        reservationSystem.releaseHold(holdId);
+                    }
+                    break;
+                }
+                case 0:
+                    // Checkpoint to the snapshot before exiting
+                    try {
+                        if (reservationSystem.checkpoint("reservations.snap")) {
+                            std::cout << "Saved reservations to reservations.snap" << std::endl;
+                        } else {
+                            std::cout << "No changes since the last save." << std::endl;
+                        }
+                    } catch (const FileIOException& e) {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                        std::cerr << "Data was not saved; bookings.wal still holds every change." << std::endl;
+                    } catch (const SnapshotFormatException& e) {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                        std::cerr << "Data was not saved; bookings.wal still holds every change." << std::endl;
+                    }
+                    
+                    // Export CSV copies for other tools
+                    try {
+                        reservationSystem.saveTrainsToCSV("trains.csv");
+                        reservationSystem.saveTicketsToCSV("tickets.csv");
+                    } catch (const FileIOException& e) {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    
+                    std::cout << "Thank you for using Railway Reservation System. Goodbye!\n";
+                    break;
+                default:
+                    std::cout << "Invalid choice. Please enter a number between 0 and 9.\n";
+            }
+            
+        } while (choice != 0);
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Critical error: " << e.what() << std::endl;
+        std::cerr << "The application will now exit." << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "Unknown critical error occurred. The application will now exit." << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
+
+#endif
@@ -0,0 +1,269 @@
+// Stress test for concurrent use of ReservationSystem. Several threads book
+// whole-route and segment seats, hold and confirm seats, cancel their own
+// tickets and read statuses and availability on the same few journeys, so
+// they keep meeting on train locks, booking shards and waitlists. Afterwards
+// every ticket is read back and checked:
+//   - each live ticket is found and each cancelled one is gone
+//   - the system holds no tickets besides the live ones
+//   - no two seated tickets share a seat on the same leg of a journey
+//   - each journey's free-seat count matches the seats its tickets leave free
+//   - each journey's waitlist positions run 1, 2, 3, ... without gaps
+// Exits with status 1 and lists the problems if any check fails.
+//
+//   g++ -std=c++17 -O2 -pthread tests/concurrency_stress_test.cpp -o concurrency_stress_test
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+#include <set>
+
+namespace {
+
+const int THREADS = 8;
+const int OPERATIONS_PER_THREAD = 20000;
+const int TRAIN_COUNT = 4;
+const int TRAIN_IDS[TRAIN_COUNT] = { 1001, 1002, 1003, 1004 };
+const int SEATS_PER_TRAIN = 100;
+const int STOPS_PER_TRAIN = 5;
+// Routes of the trains ReservationSystem starts with
+const char* const ROUTES[TRAIN_COUNT][STOPS_PER_TRAIN] = {
+    { "Mumbai Central", "Surat", "Vadodara", "Kota", "New Delhi" },
+    { "Churchgate", "Dadar", "Andheri", "Borivali", "Virar" },
+    { "Mumbai CST", "Pune", "Solapur", "Guntakal", "Chennai Central" },
+    { "Mumbai CST", "Nagpur", "Raipur", "Tatanagar", "Howrah" },
+};
+const char* const TICKETS_FILE = "concurrency_stress_test_tickets.csv";
+
+std::mutex failuresMutex;
+std::vector<std::string> failures;
+
+void fail(const std::string& problem) {
+    std::lock_guard<std::mutex> guard(failuresMutex);
+    failures.push_back(problem);
+}
+
+// Booking IDs one thread has created and cancelled
+struct ThreadBookings {
+    std::vector<std::string> live;
+    std::vector<std::string> cancelled;
+};
+
+void runClient(ReservationSystem& system, const int* journeyDates, int seed, ThreadBookings& mine) {
+    std::mt19937 random(seed);
+    for (int i = 0; i < OPERATIONS_PER_THREAD; i++) {
+        int train = static_cast<int>(random() % TRAIN_COUNT);
+        int trainId = TRAIN_IDS[train];
+        int date = journeyDates[random() % 2];
+        std::string name = "P" + std::to_string(seed) + "-" + std::to_string(i);
+        int action = static_cast<int>(random() % 100);
+
+        if (action < 30) {
+            BookingResult result = system.bookSeat(trainId, date, name, BerthPreference::None);
+            if (result.success) {
+                mine.live.push_back(result.bookingId);
+            }
+        } else if (action < 45) {
+            int from = static_cast<int>(random() % (STOPS_PER_TRAIN - 1));
+            int to = from + 1 + static_cast<int>(random() % (STOPS_PER_TRAIN - 1 - from));
+            std::string bookingId = system.bookTicket(trainId, date, ROUTES[train][from], ROUTES[train][to], name);
+            if (!bookingId.empty()) {
+                mine.live.push_back(bookingId);
+            }
+        } else if (action < 50) {
+            std::string holdId = system.holdSeat(trainId, date, name);
+            if (holdId.empty()) {
+                continue; // the journey was full
+            }
+            if (random() % 2) {
+                std::string bookingId = system.confirmHold(holdId);
+                if (bookingId.empty()) {
+                    fail("confirming hold " + holdId + " failed");
+                } else {
+                    mine.live.push_back(bookingId);
+                }
+            } else if (!system.releaseHold(holdId)) {
+                fail("releasing hold " + holdId + " failed");
+            }
+        } else if (action < 80) {
+            if (mine.live.empty()) {
+                continue;
+            }
+            size_t pick = random() % mine.live.size();
+            std::string bookingId = mine.live[pick];
+            CancelResult result = system.cancelBooking(bookingId);
+            if (!result.success) {
+                fail("cancelling own ticket " + bookingId + " failed: " + result.error);
+                continue;
+            }
+            mine.live[pick] = mine.live.back();
+            mine.live.pop_back();
+            mine.cancelled.push_back(bookingId);
+        } else if (action < 95) {
+            if (mine.live.empty()) {
+                continue;
+            }
+            std::string bookingId = mine.live[random() % mine.live.size()];
+            if (!system.findTicketStatus(bookingId).found) {
+                fail("live ticket " + bookingId + " not found while running");
+            }
+        } else {
+            int available = system.getAvailableSeats(trainId, date);
+            if (available < 0 || available > SEATS_PER_TRAIN) {
+                fail("train " + std::to_string(trainId) + " reports " + std::to_string(available) + " free seats");
+            }
+        }
+    }
+}
+
+int stopIndex(int train, const std::string& stop) {
+    for (int i = 0; i < STOPS_PER_TRAIN; i++) {
+        if (stop == ROUTES[train][i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int trainIndex(int trainId) {
+    for (int i = 0; i < TRAIN_COUNT; i++) {
+        if (TRAIN_IDS[i] == trainId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Number of data rows in a CSV file
+size_t countRows(const std::string& filename) {
+    std::ifstream file(filename);
+    std::string line;
+    size_t rows = 0;
+    while (std::getline(file, line)) {
+        rows++;
+    }
+    return rows > 0 ? rows - 1 : 0;
+}
+
+void checkFinalState(ReservationSystem& system, const int* journeyDates, const std::vector<ThreadBookings>& clients) {
+    // Legs taken per seat and waitlist positions per journey (date, train index)
+    std::map<std::pair<int, int>, std::vector<std::vector<bool> > > legsTaken;
+    std::map<std::pair<int, int>, std::vector<int> > waitlistPositions;
+    size_t liveTickets = 0;
+
+    for (const auto& client : clients) {
+        for (const auto& bookingId : client.cancelled) {
+            if (system.findTicketStatus(bookingId).found) {
+                fail("cancelled ticket " + bookingId + " is still found");
+            }
+        }
+        for (const auto& bookingId : client.live) {
+            liveTickets++;
+            StatusResult status = system.findTicketStatus(bookingId);
+            if (!status.found) {
+                fail("live ticket " + bookingId + " is not found");
+                continue;
+            }
+            const Ticket& ticket = *status.ticket;
+            int train = trainIndex(ticket.getTrainId());
+            std::pair<int, int> journey(ticket.getJourneyDate(), train);
+            if (ticket.isWaitlisted()) {
+                waitlistPositions[journey].push_back(status.waitlistPosition);
+                continue;
+            }
+            std::vector<std::vector<bool> >& seats = legsTaken[journey];
+            if (seats.empty()) {
+                seats.assign(SEATS_PER_TRAIN + 1, std::vector<bool>(STOPS_PER_TRAIN - 1, false));
+            }
+            int from = stopIndex(train, ticket.getBoardingStop());
+            int to = stopIndex(train, ticket.getAlightingStop());
+            for (int leg = from; leg < to; leg++) {
+                if (seats[ticket.getSeatNumber()][leg]) {
+                    fail("seat " + std::to_string(ticket.getSeatNumber()) + " of train " +
+                         std::to_string(ticket.getTrainId()) + " is sold twice on leg " + std::to_string(leg) +
+                         " (" + bookingId + ")");
+                }
+                seats[ticket.getSeatNumber()][leg] = true;
+            }
+        }
+    }
+
+    for (int d = 0; d < 2; d++) {
+        for (int train = 0; train < TRAIN_COUNT; train++) {
+            int free = SEATS_PER_TRAIN;
+            auto seats = legsTaken.find(std::make_pair(journeyDates[d], train));
+            if (seats != legsTaken.end()) {
+                for (int seat = 1; seat <= SEATS_PER_TRAIN; seat++) {
+                    const std::vector<bool>& legs = seats->second[seat];
+                    if (std::find(legs.begin(), legs.end(), true) != legs.end()) {
+                        free--;
+                    }
+                }
+            }
+            int reported = system.getAvailableSeats(TRAIN_IDS[train], journeyDates[d]);
+            if (reported != free) {
+                fail("train " + std::to_string(TRAIN_IDS[train]) + " on " + formatDate(journeyDates[d]) +
+                     " reports " + std::to_string(reported) + " free seats; its tickets leave " +
+                     std::to_string(free));
+            }
+        }
+    }
+
+    for (auto& journey : waitlistPositions) {
+        std::vector<int>& positions = journey.second;
+        std::sort(positions.begin(), positions.end());
+        for (size_t i = 0; i < positions.size(); i++) {
+            if (positions[i] != static_cast<int>(i) + 1) {
+                fail("waitlist of train " + std::to_string(TRAIN_IDS[journey.first.second]) + " on " +
+                     formatDate(journey.first.first) + " has position " + std::to_string(positions[i]) +
+                     " where " + std::to_string(i + 1) + " was expected");
+                break;
+            }
+        }
+    }
+
+    system.saveTicketsToCSV(TICKETS_FILE);
+    size_t stored = countRows(TICKETS_FILE);
+    std::remove(TICKETS_FILE);
+    if (stored != liveTickets) {
+        fail("the system holds " + std::to_string(stored) + " tickets but " + std::to_string(liveTickets) +
+             " are live");
+    }
+}
+
+}
+
+int main() {
+    // The system reports every request on the console; only the verdict matters here
+    std::cout.setstate(std::ios::failbit);
+    std::cerr.setstate(std::ios::failbit);
+
+    ReservationSystem system;
+    int journeyDates[2] = { todayDate(), addDays(todayDate(), 1) };
+    std::vector<ThreadBookings> clients(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back(runClient, std::ref(system), journeyDates, t + 1, std::ref(clients[t]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    checkFinalState(system, journeyDates, clients);
+
+    size_t live = 0;
+    size_t cancelled = 0;
+    for (const auto& client : clients) {
+        live += client.live.size();
+        cancelled += client.cancelled.size();
+    }
+    if (failures.empty()) {
+        std::printf("PASS: %d threads x %d operations, %zu live and %zu cancelled tickets\n",
+                    THREADS, OPERATIONS_PER_THREAD, live, cancelled);
+        return 0;
+    }
+    std::printf("FAIL: %zu problems\n", failures.size());
+    for (size_t i = 0; i < failures.size() && i < 20; i++) {
+        std::printf("  %s\n", failures[i].c_str());
+    }
+    return 1;
+}
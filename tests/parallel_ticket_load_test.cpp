@@ -0,0 +1,183 @@
+// Test that loading tickets.csv on several threads gives the same result as
+// loading it on one. The file is big enough to be cut into pieces and holds
+// rows that only a one-thread, file-order load settles correctly:
+//   - a repeated booking ID whose first row names an unknown train
+//   - a repeated booking ID on two trains, both with free seats
+//   - a repeated booking ID whose first row loses its seat to an earlier row
+//   - a repeated booking ID on one train
+//   - a seat that is free again only because the row holding it repeated an ID
+// The tickets, the free-seat counts of every journey and the error messages
+// of the two loads are compared. Exits with status 1 and lists the problems
+// if any check fails.
+//
+//   g++ -std=c++17 -O2 -pthread tests/parallel_ticket_load_test.cpp -o parallel_ticket_load_test
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+
+namespace {
+
+const int TRAINS = 100;
+const int SEATS = 1200;
+const int FILLED_SEATS = 1000; // the generated rows use seats up to this; the special rows use the rest
+const int ROWS = 100000;       // about 7 MB, so the file is cut into several pieces
+const size_t THREADS = 4;
+const char* const TRAINS_FILE = "parallel_ticket_load_test_trains.csv";
+const char* const TICKETS_FILE = "parallel_ticket_load_test_tickets.csv";
+const char* const SAVED_FILE = "parallel_ticket_load_test_saved.csv";
+
+std::vector<std::string> failures;
+
+void fail(const std::string& problem) {
+    failures.push_back(problem);
+}
+
+// A row placed at a given share of the file
+struct SpecialRow {
+    int percent;
+    std::string bookingId;
+    int trainId;
+    int seat;
+};
+
+const SpecialRow SPECIAL_ROWS[] = {
+    { 10, "DUPX0001", 999, 1 },      // unknown train; the row at 60% loads
+    { 60, "DUPX0001", 1, 1100 },
+    { 20, "DUPX0002", 2, 1100 },     // loads; the row at 70% is a repeat
+    { 70, "DUPX0002", 3, 1100 },
+    { 25, "CLASH001", 4, 1100 },     // takes the seat the row at 30% wants
+    { 30, "DUPX0003", 4, 1100 },
+    { 80, "DUPX0003", 5, 1100 },     // so this one loads
+    { 15, "CHAIN001", 6, 1100 },     // loads; the row at 40% is a repeat
+    { 40, "CHAIN001", 7, 1100 },
+    { 90, "LATE0001", 7, 1100 },     // so its seat is free for this one
+    { 35, "DUPX0004", 8, 1100 },     // loads; the row at 85% is a repeat
+    { 85, "DUPX0004", 8, 1101 },
+};
+
+void writeFiles(const std::string& date) {
+    std::ofstream trains(TRAINS_FILE);
+    trains << "trainId,trainName,totalSeats,availableSeats,berthsPerCoach,stops,seatMapMode\n";
+    for (int t = 1; t <= TRAINS; t++) {
+        trains << t << ",Train " << t << "," << SEATS << "," << SEATS << ",72,Origin|Destination,locked\n";
+    }
+
+    std::ofstream tickets(TICKETS_FILE);
+    tickets << "bookingId,trainId,seatNumber,passengerName,boardingStop,alightingStop,journeyDate,"
+            << "waitlistNumber,waitlistPosition,bookingTime\n";
+    auto writeRow = [&](const std::string& bookingId, int trainId, int seat) {
+        tickets << bookingId << "," << trainId << "," << seat << ",Passenger,Origin,Destination," << date
+                << ",0,0,Mon Jan  1 09:00:00 2024\n";
+    };
+    for (int i = 0; i < ROWS; i++) {
+        for (const auto& special : SPECIAL_ROWS) {
+            if (i == ROWS / 100 * special.percent) {
+                writeRow(special.bookingId, special.trainId, special.seat);
+            }
+        }
+        char bookingId[16];
+        std::snprintf(bookingId, sizeof(bookingId), "ROW%07d", i);
+        writeRow(bookingId, i % TRAINS + 1, i / TRAINS % FILLED_SEATS + 1);
+    }
+}
+
+// What a load left behind: the saved tickets sorted, the free seats of every
+// journey and the error messages in the order they were printed
+struct LoadOutcome {
+    std::vector<std::string> tickets;
+    std::vector<int> freeSeats;
+    std::string errors;
+};
+
+LoadOutcome load(size_t threads, int date) {
+    LoadOutcome outcome;
+    ReservationSystem system;
+    system.loadTrainsFromCSV(TRAINS_FILE);
+
+    std::ostringstream errors;
+    std::streambuf* console = std::cerr.rdbuf(errors.rdbuf());
+    std::cerr.clear();
+    system.loadTicketsFromCSV(TICKETS_FILE, threads);
+    std::cerr.rdbuf(console);
+    std::cerr.setstate(std::ios::failbit);
+    outcome.errors = errors.str();
+
+    system.saveTicketsToCSV(SAVED_FILE);
+    std::ifstream saved(SAVED_FILE);
+    std::string line;
+    while (std::getline(saved, line)) {
+        outcome.tickets.push_back(line);
+    }
+    std::remove(SAVED_FILE);
+    std::sort(outcome.tickets.begin(), outcome.tickets.end());
+
+    for (int t = 1; t <= TRAINS; t++) {
+        outcome.freeSeats.push_back(system.getAvailableSeats(t, date));
+    }
+    return outcome;
+}
+
+bool hasTicket(const LoadOutcome& outcome, const std::string& bookingId, int trainId) {
+    std::string prefix = bookingId + "," + std::to_string(trainId) + ",";
+    for (const auto& ticket : outcome.tickets) {
+        if (ticket.compare(0, prefix.size(), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+int main() {
+    // The system reports every load on the console; only the verdict matters here
+    std::cout.setstate(std::ios::failbit);
+    std::cerr.setstate(std::ios::failbit);
+
+    int date = todayDate();
+    writeFiles(formatDate(date));
+    LoadOutcome single = load(1, date);
+    LoadOutcome parallel = load(THREADS, date);
+    std::remove(TRAINS_FILE);
+    std::remove(TICKETS_FILE);
+
+    if (single.tickets != parallel.tickets) {
+        fail(std::to_string(single.tickets.size()) + " tickets on one thread and " +
+             std::to_string(parallel.tickets.size()) + " on " + std::to_string(THREADS) +
+             ", or the same number with different contents");
+    }
+    for (int t = 0; t < TRAINS; t++) {
+        if (single.freeSeats[t] != parallel.freeSeats[t]) {
+            fail("train " + std::to_string(t + 1) + ": " + std::to_string(single.freeSeats[t]) +
+                 " free seats on one thread, " + std::to_string(parallel.freeSeats[t]) + " on " +
+                 std::to_string(THREADS));
+        }
+    }
+    if (single.errors != parallel.errors) {
+        fail("the error messages differ:\n--- one thread\n" + single.errors + "--- " + std::to_string(THREADS) +
+             " threads\n" + parallel.errors);
+    }
+
+    // The one-thread load itself, against what file order decides
+    const std::pair<const char*, int> expected[] = {
+        { "DUPX0001", 1 }, { "DUPX0002", 2 }, { "CLASH001", 4 }, { "DUPX0003", 5 },
+        { "CHAIN001", 6 }, { "LATE0001", 7 }, { "DUPX0004", 8 },
+    };
+    for (const auto& ticket : expected) {
+        if (!hasTicket(parallel, ticket.first, ticket.second)) {
+            fail(std::string(ticket.first) + " is not loaded on train " + std::to_string(ticket.second));
+        }
+    }
+
+    if (failures.empty()) {
+        std::printf("PASS: loading tickets on %zu threads matches a one-thread load\n", THREADS);
+        return 0;
+    }
+    std::printf("FAIL: %zu problems\n", failures.size());
+    for (const auto& problem : failures) {
+        std::printf("  %s\n", problem.c_str());
+    }
+    return 1;
+}
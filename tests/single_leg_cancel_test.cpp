@@ -0,0 +1,108 @@
+// Test for cancellation on trains with no intermediate stops. Such trains keep
+// no per-leg seat maps, so freeing a seat goes through a different path from
+// multi-stop trains. A small single-leg train is filled, one ticket is
+// cancelled and the test checks:
+//   - the free-seat count goes back up by one
+//   - the next booking gets the cancelled seat
+//   - the same holds for a ticket booked between the train's two stops
+// Exits with status 1 and lists the problems if any check fails.
+//
+//   g++ -std=c++17 -O2 -pthread tests/single_leg_cancel_test.cpp -o single_leg_cancel_test
+
+#define RAILWAY_NO_MAIN
+#include "../railway_reservation.cpp"
+
+#include <cstdio>
+
+namespace {
+
+const int TRAIN_ID = 2001;
+const int SEATS = 4;
+const char* const FROM_STOP = "Pune";
+const char* const TO_STOP = "Mumbai CST";
+const char* const TRAINS_FILE = "single_leg_cancel_test_trains.csv";
+
+std::vector<std::string> failures;
+
+void fail(const std::string& problem) {
+    failures.push_back(problem);
+}
+
+void checkFreeSeats(ReservationSystem& system, int date, int expected, const std::string& when) {
+    int free = system.getAvailableSeats(TRAIN_ID, date);
+    if (free != expected) {
+        fail(when + ": " + std::to_string(free) + " free seats, expected " + std::to_string(expected));
+    }
+}
+
+// Books every seat, cancels the second ticket and books once more; book
+// returns the new booking ID, or an empty string if the booking failed
+template <typename Book>
+void cancelAndRebook(ReservationSystem& system, int date, const std::string& kind, Book book) {
+    std::vector<std::string> bookingIds;
+    for (int i = 0; i < SEATS; i++) {
+        std::string bookingId = book("P" + std::to_string(i));
+        if (bookingId.empty()) {
+            fail(kind + ": booking " + std::to_string(i + 1) + " of " + std::to_string(SEATS) + " failed");
+            return;
+        }
+        bookingIds.push_back(bookingId);
+    }
+    checkFreeSeats(system, date, 0, kind + " after filling the train");
+
+    StatusResult cancelled = system.findTicketStatus(bookingIds[1]);
+    if (!cancelled.found || !system.cancelBooking(bookingIds[1]).success) {
+        fail(kind + ": cancelling " + bookingIds[1] + " failed");
+        return;
+    }
+    checkFreeSeats(system, date, 1, kind + " after cancelling");
+
+    std::string rebooked = book("Rebooked");
+    StatusResult status = system.findTicketStatus(rebooked);
+    if (rebooked.empty() || !status.found) {
+        fail(kind + ": rebooking the cancelled seat failed");
+    } else if (status.ticket->isWaitlisted() ||
+               status.ticket->getSeatNumber() != cancelled.ticket->getSeatNumber()) {
+        fail(kind + ": rebooking did not get cancelled seat " +
+             std::to_string(cancelled.ticket->getSeatNumber()));
+    }
+    checkFreeSeats(system, date, 0, kind + " after rebooking");
+}
+
+}
+
+int main() {
+    // The system reports every request on the console; only the verdict matters here
+    std::cout.setstate(std::ios::failbit);
+    std::cerr.setstate(std::ios::failbit);
+
+    {
+        std::ofstream trains(TRAINS_FILE);
+        trains << "trainId,trainName,totalSeats,availableSeats,berthsPerCoach,stops,seatMapMode\n"
+               << TRAIN_ID << ",Deccan Queen," << SEATS << "," << SEATS << ",72,"
+               << FROM_STOP << "|" << TO_STOP << ",locked\n";
+    }
+    ReservationSystem system;
+    system.loadTrainsFromCSV(TRAINS_FILE);
+    std::remove(TRAINS_FILE);
+
+    int today = todayDate();
+    cancelAndRebook(system, today, "whole route", [&](const std::string& name) {
+        BookingResult result = system.bookSeat(TRAIN_ID, today, name, BerthPreference::None);
+        return result.success && result.waitlistPosition == 0 ? result.bookingId : std::string();
+    });
+    int tomorrow = addDays(today, 1);
+    cancelAndRebook(system, tomorrow, "between stops", [&](const std::string& name) {
+        return system.bookTicket(TRAIN_ID, tomorrow, FROM_STOP, TO_STOP, name);
+    });
+
+    if (failures.empty()) {
+        std::printf("PASS: cancelled seats on a single-leg train are sold again\n");
+        return 0;
+    }
+    std::printf("FAIL: %zu problems\n", failures.size());
+    for (const auto& problem : failures) {
+        std::printf("  %s\n", problem.c_str());
+    }
+    return 1;
+}